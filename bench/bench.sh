@@ -16,11 +16,13 @@ RUNTIME_LL="${12}"
 LLI="${13}"
 LLVM_LINK="${14}"
 BUILTINS="${15}"
+COLLATZ_E1="${16}"
+GCD_E1="${17}"
 
 # Default iterations and n
 ITERS=2000
 N=31
-shift 15 2>/dev/null || true
+shift 17 2>/dev/null || true
 if [ "$1" = "--" ]; then
     shift
     ITERS=${1:-2000}
@@ -52,9 +54,11 @@ if [ -n "$LLI" ] && [ -x "$LLI" ]; then
 fi
 
 if [ -n "$E1" ] && [ -x "$E1" ]; then
-    echo "=== C++ interpreter ==="
-    time "$E1" "$FACTORIAL_E1" "$ITERS" "$N"
-    echo ""
+    for engine in vm closure ast; do
+        echo "=== C++ interpreter (--engine=$engine) ==="
+        time "$E1" --engine=$engine "$FACTORIAL_E1" "$ITERS" "$N"
+        echo ""
+    done
 fi
 
 if [ -n "$E1_KOKA" ] && [ -x "$E1_KOKA" ]; then
@@ -80,3 +84,17 @@ if [ -n "$E3PEG" ] && [ -x "$E3PEG" ]; then
     time "$E3PEG" "$FACTORIAL_E3" "$ITERS" "$N"
     echo ""
 fi
+
+# Engine comparison on the other e1 workloads (C++ interpreter only)
+if [ -n "$E1" ] && [ -x "$E1" ] && [ -n "$COLLATZ_E1" ] && [ -n "$GCD_E1" ]; then
+    echo "Benchmark: C++ interpreter engines on collatz(6171), gcd(1000000, 7)"
+    echo ""
+    for engine in vm closure ast; do
+        echo "=== collatz.e1 (--engine=$engine) ==="
+        time "$E1" --engine=$engine "$COLLATZ_E1" 6171 > /dev/null
+        echo ""
+        echo "=== gcd.e1 (--engine=$engine) ==="
+        time "$E1" --engine=$engine "$GCD_E1" 1000000 7
+        echo ""
+    done
+fi
@@ -42,3 +42,39 @@ echo "========== INT_BITS=512 =========="
 echo "=== C++ interpreter ==="
 time "$E1_INT512" "$FACTORIAL_E1" $ITERS $N
 echo ""
+
+# Additions and subtractions of multi-limb values with both signs (the
+# add/sub kernels, no multiplication): Fibonacci numbers up to ~7000 bits
+ADDSUB_E1=$(mktemp --suffix=.e1)
+trap 'rm -f "$ADDSUB_E1"' EXIT
+cat > "$ADDSUB_E1" <<'E1'
+iterations := arg1
+total := 0
+loop {
+  break_ifz iterations
+  n := arg2
+  a := 1
+  b := 0
+  loop {
+    break_ifz n
+    c := a + b
+    d := b - a
+    e := d + c
+    b := a
+    a := c
+    n := n - 1
+  }
+  total := total + e
+  iterations := iterations - 1
+}
+print total
+E1
+
+echo "Benchmark: add/sub, fib(10000) x 40 iterations"
+echo ""
+for limb in 32 64 128; do
+    echo "========== INT_BITS=0, LIMB_BITS=$limb =========="
+    bin="E1_INT0_LIMB$limb"
+    time "${!bin}" "$ADDSUB_E1" 40 10000
+    echo ""
+done
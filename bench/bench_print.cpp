@@ -0,0 +1,64 @@
+// Benchmark for bigint decimal output (bigint::print)
+// Usage: bench_print [reps]
+//
+// Prints random 10^3 .. 10^6 digit values to /dev/null and reports the time
+// per print on stderr. The first print of each size also builds the power
+// table used by the divide-and-conquer split, so it is reported separately.
+#include "e1_bigint.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <print>
+#include <unistd.h>
+
+using namespace bigint;
+using Clock = std::chrono::steady_clock;
+
+// Random magnitude with exactly `digits` decimal digits (approximately; the
+// top limb is kept nonzero)
+static Raw* random_value(size_t digits, uint64_t& seed) {
+    auto n = Size(std::ceil(double(digits) / (LimbBits * 0.30103)));
+    auto* v = static_cast<Raw*>(std::malloc(Raw::buf_size(n)));
+    v->size = n;
+    v->neg = false;
+    for (Size i = 0; i < n; i++) {
+        Limb x = 0;
+        for (int k = 0; k < LimbBits; k += 64) {
+            seed ^= seed << 13, seed ^= seed >> 7, seed ^= seed << 17;  // xorshift64
+            x = (x << (k ? 64 : 0)) | seed;
+        }
+        v->limbs[i] = x;
+    }
+    v->limbs[n - 1] |= 1;
+    return v;
+}
+
+static double ms_since(Clock::time_point t0) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+}
+
+int main(int argc, char** argv) {
+    int reps = argc > 1 ? std::atoi(argv[1]) : 5;
+    // Output goes to fd 1 through the shared buffer (e1_out.hpp)
+    int null = open("/dev/null", O_WRONLY);
+    if (null < 0 || dup2(null, 1) < 0) return 1;
+    uint64_t seed = 0x9E3779B97F4A7C15;
+
+    std::println(stderr, "Benchmark: bigint::print (LIMB_BITS={}, {} reps)", LIMB_BITS, reps);
+    std::println(stderr, "{:>10} {:>8} {:>12} {:>12}", "digits", "limbs", "first (ms)", "avg (ms)");
+    for (size_t digits = 1000; digits <= 1000000; digits *= 10) {
+        auto* v = random_value(digits, seed);
+        auto t0 = Clock::now();
+        print(*v);
+        out::flush();
+        double first = ms_since(t0);
+        t0 = Clock::now();
+        for (int i = 0; i < reps; i++) print(*v);
+        out::flush();
+        std::println(stderr, "{:>10} {:>8} {:>12.3f} {:>12.3f}", digits, v->size, first,
+                     ms_since(t0) / reps);
+        std::free(v);
+    }
+}
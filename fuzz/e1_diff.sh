@@ -3,9 +3,11 @@
 #
 # Generates random e1 programs with efuzz and runs each on every e1
 # implementation. Compares all outputs against the generator's co-evaluated
-# expected output. The C++ compiler backend is only checked for emit success
-# (compiling its output needs a host C++ compiler); the LLVM backend is
-# executed via the hermetic lli JIT.
+# expected output; e1 runs both with (-O1) and without (-O0) the AST
+# optimizer, and on the baseline JIT (from the start and via --tier-up).
+# The C++ compiler backend is only checked for emit success (compiling its
+# output needs a host C++ compiler); the LLVM backend, with bigint and with
+# --hybrid integers, is executed via the hermetic lli JIT.
 #
 # NOTE: e2/e3/e4 PEG interpreters are not in the matrix: their grammars
 # deliberately dropped break_ifz (replaced by case/break), so they cannot
@@ -58,24 +60,31 @@ for ((seed = SEED0; seed < SEED0 + COUNT; seed++)); do
     expected=$(sed -n 's|^// expect: ||p' "$prog")
 
     run_filtered "$E1" "$prog" > "$TMP/out_e1"
+    run_filtered "$E1" -O0 "$prog" > "$TMP/out_e1_O0"
+    run_filtered "$E1" --engine=baseline-jit "$prog" > "$TMP/out_e1_bjit"
+    run_filtered "$E1" --engine=baseline-jit --tier-up=2 "$prog" > "$TMP/out_e1_tier"
     run_filtered "$E1_KOKA" "$prog" > "$TMP/out_e1_koka"
     run_filtered "$E1PEG" "$prog" > "$TMP/out_e1peg"
 
     mismatches=""
 
-    if "$E1_COMPILE" --llvm "$prog" > "$TMP/prog.ll" 2>/dev/null \
-        && "$LLVM_LINK" -S "$RT_LL" "$TMP/prog.ll" -o "$TMP/linked.ll" 2>/dev/null; then
-        run_filtered "$LLI" --extra-archive="$BUILTINS" "$TMP/linked.ll" > "$TMP/out_llvmjit"
-    else
-        mismatches="$mismatches llvmjit(compile-failed)"
-        : > "$TMP/out_llvmjit"
-    fi
+    # bigint and hybrid (int64 promoted to bigint on overflow) LLVM code
+    for mode in llvmjit:--llvm llvmjit_hybrid:"--llvm --hybrid"; do
+        name=${mode%%:*}
+        if "$E1_COMPILE" ${mode#*:} "$prog" > "$TMP/prog.ll" 2>/dev/null \
+            && "$LLVM_LINK" -S "$RT_LL" "$TMP/prog.ll" -o "$TMP/linked.ll" 2>/dev/null; then
+            run_filtered "$LLI" --extra-archive="$BUILTINS" "$TMP/linked.ll" > "$TMP/out_$name"
+        else
+            mismatches="$mismatches $name(compile-failed)"
+            : > "$TMP/out_$name"
+        fi
+    done
 
     if ! "$E1_COMPILE" "$prog" > /dev/null 2>&1; then
         mismatches="$mismatches cpp-backend(emit-failed)"
     fi
 
-    for name in e1 e1_koka e1peg llvmjit; do
+    for name in e1 e1_O0 e1_bjit e1_tier e1_koka e1peg llvmjit llvmjit_hybrid; do
         if [ "$(cat "$TMP/out_$name")" != "$expected" ]; then
             mismatches="$mismatches $name"
         fi
@@ -88,7 +97,7 @@ for ((seed = SEED0; seed < SEED0 + COUNT; seed++)); do
         fail=$((fail + 1))
         mkdir -p "$OUTDIR"
         cp "$prog" "$OUTDIR/seed_$seed.e1"
-        for name in e1 e1_koka e1peg llvmjit; do
+        for name in e1 e1_O0 e1_bjit e1_tier e1_koka e1peg llvmjit llvmjit_hybrid; do
             cp "$TMP/out_$name" "$OUTDIR/seed_${seed}_$name.out"
         done
         echo "  program and outputs saved to $OUTDIR/seed_$seed*"
@@ -1,16 +1,25 @@
 #!/bin/bash
 # Differential fuzzing driver for e2 (see docs/FUZZING.md)
 #
-# Generates random e2 programs with efuzz (level 2) and runs each on e2peg
-# and e3peg (e2 -> e3 is a true superset; e4peg is excluded because its
-# case statement requires a scrutinee, see DESIGN.md "Superset deviations").
-# Compares both outputs against the generator's co-evaluated expected output.
+# Generates random e2 programs with efuzz (level 2) and runs each on e2peg,
+# e3peg (e2 -> e3 is a true superset; e4peg is excluded because its case
+# statement requires a scrutinee, see DESIGN.md "Superset deviations") and
+# the C++ e2 interpreter (at -O1 and -O0, and on the baseline JIT).
+# Compares all outputs against the generator's co-evaluated expected output.
+# As in e1_diff.sh, the C++ backend is only checked for emit success and the
+# LLVM backend runs on the hermetic lli JIT (bigint and --hybrid).
 set -u
 
 EFUZZ="$1"
 E2PEG="$2"
 E3PEG="$3"
-shift 3
+E2="$4"
+E2_COMPILE="$5"
+LLI="$6"
+LLVM_LINK="$7"
+RT_LL="$8"
+BUILTINS="$9"
+shift 9
 
 COUNT=20
 SEED0=1
@@ -48,9 +57,30 @@ for ((seed = SEED0; seed < SEED0 + COUNT; seed++)); do
 
     run_filtered "$E2PEG" "$prog" > "$TMP/out_e2peg"
     run_filtered "$E3PEG" "$prog" > "$TMP/out_e3peg"
+    run_filtered "$E2" "$prog" > "$TMP/out_e2"
+    run_filtered "$E2" -O0 "$prog" > "$TMP/out_e2_O0"
+    run_filtered "$E2" --engine=baseline-jit "$prog" > "$TMP/out_e2_bjit"
+    run_filtered "$E2" --engine=baseline-jit --tier-up=2 "$prog" > "$TMP/out_e2_tier"
 
     mismatches=""
-    for name in e2peg e3peg; do
+
+    # bigint and hybrid (int64 promoted to bigint on overflow) LLVM code
+    for mode in llvmjit:--llvm llvmjit_hybrid:"--llvm --hybrid"; do
+        name=${mode%%:*}
+        if "$E2_COMPILE" ${mode#*:} "$prog" > "$TMP/prog.ll" 2>/dev/null \
+            && "$LLVM_LINK" -S "$RT_LL" "$TMP/prog.ll" -o "$TMP/linked.ll" 2>/dev/null; then
+            run_filtered "$LLI" --extra-archive="$BUILTINS" "$TMP/linked.ll" > "$TMP/out_$name"
+        else
+            mismatches="$mismatches $name(compile-failed)"
+            : > "$TMP/out_$name"
+        fi
+    done
+
+    if ! "$E2_COMPILE" "$prog" > /dev/null 2>&1; then
+        mismatches="$mismatches cpp-backend(emit-failed)"
+    fi
+
+    for name in e2peg e3peg e2 e2_O0 e2_bjit e2_tier llvmjit llvmjit_hybrid; do
         if [ "$(cat "$TMP/out_$name")" != "$expected" ]; then
             mismatches="$mismatches $name"
         fi
@@ -81,7 +111,7 @@ for ((seed = SEED0; seed < SEED0 + COUNT; seed++)); do
         fail=$((fail + 1))
         mkdir -p "$OUTDIR"
         cp "$prog" "$OUTDIR/e2_seed_$seed.e2"
-        for name in e2peg e3peg; do
+        for name in e2peg e3peg e2 e2_O0 e2_bjit e2_tier llvmjit llvmjit_hybrid; do
             cp "$TMP/out_$name" "$OUTDIR/e2_seed_${seed}_$name.out"
         done
         echo "  program and outputs saved to $OUTDIR/e2_seed_$seed*"
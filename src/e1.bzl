@@ -1,13 +1,14 @@
 load("@rules_cc//cc:defs.bzl", "cc_binary")
 
 # Macro for compiling e1 source to native binary via C++ backend.
-def e1_cpp_binary(name, src):
+# compiler = "//src:e2_compile" compiles e2 sources; flags go to the compiler.
+def e1_cpp_binary(name, src, compiler = "//src:e1_compile", flags = ""):
     native.genrule(
         name = name + "_cpp_gen",
         srcs = [src],
         outs = [name + ".cpp"],
-        cmd = "$(location //src:e1_compile) $< > $@",
-        tools = ["//src:e1_compile"],
+        cmd = "$(location " + compiler + ") " + flags + " $< > $@",
+        tools = [compiler],
     )
     cc_binary(
         name = name,
@@ -22,13 +23,13 @@ def e1_cpp_binary(name, src):
 # Uses llvm-link to merge IR files before clang -O3, enabling cross-module optimization.
 # Note: -march=native is used here (final link step), but NOT in e1_rt_bigint_ll (IR generation)
 # because CPU-specific intrinsics in IR prevent optimization when linked (2x slowdown).
-def e1_llvm_binary(name, src):
+def e1_llvm_binary(name, src, compiler = "//src:e1_compile", flags = ""):
     native.genrule(
         name = name + "_ll_gen",
         srcs = [src],
         outs = [name + ".ll"],
-        cmd = "$(location //src:e1_compile) --llvm $< > $@",
-        tools = ["//src:e1_compile"],
+        cmd = "$(location " + compiler + ") --llvm " + flags + " $< > $@",
+        tools = [compiler],
         visibility = ["//visibility:public"],
     )
     native.genrule(
@@ -63,3 +64,11 @@ def e1_llvm_binary(name, src):
         local = True,
         visibility = ["//visibility:public"],
     )
+
+# Hybrid integers (e1_compile --hybrid, src/e1_hybrid.hpp): native int64 with
+# promotion to bigint on overflow, through either backend.
+def e1_hybrid_cpp_binary(name, src, compiler = "//src:e1_compile"):
+    e1_cpp_binary(name, src, compiler, flags = "--hybrid")
+
+def e1_hybrid_llvm_binary(name, src, compiler = "//src:e1_compile"):
+    e1_llvm_binary(name, src, compiler, flags = "--hybrid")
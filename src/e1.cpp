@@ -1,64 +1,127 @@
-// PL/0 Level 1 Interpreter (C++23)
+// PL/0 Level 1 Interpreter (C++23); built with -DLEVEL=2 it is the e2
+// interpreter (//src:e2)
+//
+// Three execution engines over the same parsed program:
+//   --engine=vm  (default) bytecode compiler + direct-threaded VM, see e1_vm.hpp
+//   --engine=closure       AST compiled once into pre-bound closures, see e1_closure.hpp
+//   --engine=ast           tree walker, see libe1.cpp
+//   --engine=baseline-jit  VM bytecode copied-and-patched into native code,
+//                          see e1_baseline.hpp; --tier-up[=N] starts in the VM
+//                          and moves a loop to native code after N iterations
+//   --jit                  LLVM backend compiled and run in-process with ORC
+//                          (//src:e1_jit and //src:e2_jit builds), see e1_jit.hpp
+// The AST optimizer (e1_opt.hpp) runs first unless -O0 is given. With
+// $E1_CACHE_DIR set, the optimized program (for --jit, the compiled module) is
+// cached by source and a warm start skips the frontend (e1_cache.hpp);
+// --cache-stats reports on the cache.
+// The engines are run through the C API of libe1.h (//src:libe1), as an
+// embedding program would. Output goes through the shared buffer in
+// e1_out.hpp (--unbuffered: per line).
+// --batch inputs.csv runs the program once per row of arguments on a thread
+// pool (--jobs N, default: one per core), see e1_batch.hpp.
+// --parallel[=N] runs loops that only count down and add to accumulators on
+// N threads (default: one per core) with the sequential result, see
+// e1_par.hpp.
+#include "libe1.h"
 #include "e1.hpp"
-#include <unordered_map>
-
-using Env = std::unordered_map<std::string, Int>;
-
-Int eval(Expr* e, Env& env) {
-    if (auto* n = dynamic_cast<NumberExpr*>(e)) return n->val;
-    if (auto* v = dynamic_cast<VarExpr*>(e)) return env[v->name];
-    if (auto* u = dynamic_cast<NegExpr*>(e)) return -eval(u->e.get(), env);
-    if (auto* b = dynamic_cast<BinExpr*>(e)) {
-        Int l = eval(b->l.get(), env), r = eval(b->r.get(), env);
-        if (b->op == '+') return l + r;
-        return l - r;
-    }
-    return 0;
-}
-
-struct Break {};
-
-void print_int(const Int& v) {
-#if INT_BITS == 0
-    v.str();
-#else
-    if (v == 0) { std::println("0"); return; }
-    std::string s; Int x = v; bool neg = x < 0; if (neg) x = -x;
-    while (x) { s = char('0' + int(x % 10)) + s; x /= 10; }
-    std::println("{}", neg ? "-" + s : s);
+#include "e1_batch.hpp"
+#include "e1_cache.hpp"
+#include <charconv>
+#ifdef E1_JIT
+#include "e1_jit.hpp"
 #endif
-}
 
-Int parse_arg(int argc, char** argv, int idx) {
-#if INT_BITS == 0
-    return argc > idx ? Int(argv[idx]) : Int(0);
-#else
-    return argc > idx ? std::atoll(argv[idx]) : 0;
+int main(int argc, char** argv) {
+    std::string_view engine = "vm";
+    bool optimize = true, use_jit = false, cache_stats = false;
+    uint32_t hot = 0;  // --tier-up threshold
+    const char* batch = nullptr;  // --batch inputs.csv
+    unsigned jobs = std::max(std::thread::hardware_concurrency(), 1u);  // 0 only from --jobs: rejected
+    unsigned threads = 0;  // --parallel
+#ifdef E1_JIT
+    jit::Options jopt;
 #endif
-}
-
-void exec(Stmt* s, Env& env) {
-    if (auto* d = dynamic_cast<DeclStmt*>(s)) env.try_emplace(d->name, 0);
-    else if (auto* a = dynamic_cast<AssignStmt*>(s)) env[a->name] = eval(a->e.get(), env);
-    else if (auto* b = dynamic_cast<BlockStmt*>(s)) for (auto& st : b->stmts) exec(st.get(), env);
-    else if (auto* l = dynamic_cast<LoopStmt*>(s)) {
-        try { while (true) exec(l->body.get(), env); } catch (Break) {}
+    std::vector<char*> args;  // <file> [arg1..argN]
+    for (int i = 1; i < argc; ++i) {
+        std::string_view a = argv[i];
+        if (a.starts_with("--engine=")) engine = a.substr(9);
+        else if (a == "--unbuffered") out::unbuffered = true;
+        else if (a == "-O0" || a == "-O1") optimize = a == "-O1";
+        else if (a == "--jit") use_jit = true;
+        else if (a == "--cache-stats") cache_stats = true;
+        else if (a == "--batch" && i + 1 < argc) batch = argv[++i];
+        else if (a == "--jobs" && i + 1 < argc) {
+            std::string_view n = argv[++i];
+            if (std::from_chars(n.data(), n.data() + n.size(), jobs).ec != std::errc{}) jobs = 0;
+        }
+        else if (a == "--parallel") threads = std::max(std::thread::hardware_concurrency(), 1u);
+        else if (a.starts_with("--parallel=")) {
+            auto n = a.substr(11);
+            if (std::from_chars(n.data(), n.data() + n.size(), threads).ec != std::errc{} || threads == 0) threads = UINT32_MAX;
+        }
+        else if (a == "--tier-up") hot = 1000;
+        else if (a.starts_with("--tier-up=")) {
+            auto n = a.substr(10);
+            if (std::from_chars(n.data(), n.data() + n.size(), hot).ec != std::errc{} || hot == 0) hot = UINT32_MAX;
+        }
+#ifdef E1_JIT
+        else if (a.starts_with("--jit-passes=")) jopt.passes = a.substr(13);
+        else if (a == "--jit-stats") jopt.stats = true;
+#endif
+        else args.push_back(argv[i]);
     }
-    else if (auto* b = dynamic_cast<BreakIfzStmt*>(s)) { if (eval(b->cond.get(), env) == 0) throw Break{}; }
-    else if (auto* pr = dynamic_cast<PrintStmt*>(s)) print_int(eval(pr->e.get(), env));
-}
-
-int main(int argc, char** argv) {
-    if (argc < 2) { std::println(stderr, "Usage: {} <file> [arg1..arg{}]", argv[0], ARG_COUNT); return 1; }
-    auto prog = parse_program(read_file(argv[1]));
-    if (!prog) { std::println(stderr, "Error: {}", prog.error()); return 1; }
-
-    Env env;
-    for (int i = 1; i <= ARG_COUNT; ++i)
-        env[std::format("arg{}", i)] = parse_arg(argc, argv, i + 1);
+    if (cache_stats) return cache::print_stats();
+    if (args.empty() || (engine != "vm" && engine != "closure" && engine != "ast" && engine != "baseline-jit") ||
+        (hot && engine != "baseline-jit") || hot == UINT32_MAX || (batch && (args.size() != 1 || use_jit)) || (threads && use_jit) || threads == UINT32_MAX || jobs == 0) {
+        std::println(stderr, "Usage: {} [--engine=vm|closure|ast | --engine=baseline-jit [--tier-up[=N]] | --jit [--jit-passes=P] [--jit-stats]] [-O0|-O1] [--parallel[=N]] [--unbuffered] <file> [arg1..arg{}]\n"
+                             "       {} [--engine=...] [-O0|-O1] [--parallel[=N]] --batch <inputs.csv> [--jobs N] <file>\n"
+                             "       {} --cache-stats", argv[0], ARG_COUNT, argv[0], argv[0]);
+        return 1;
+    }
+#ifndef E1_JIT
+    if (use_jit) { std::println(stderr, "Error: built without --jit (use //src:e1_jit)"); return 1; }
+#endif
+    auto src = read_file(args[0]);
+    if (!src) { std::println(stderr, "Error: {}", src.error()); return 1; }
+    std::optional<batch::Table> table;
+    if (batch) {
+        auto t = batch::read_csv(batch);
+        if (!t) { std::println(stderr, "Error: {}", t.error()); return 1; }
+        table = std::move(*t);
+    }
+#ifdef E1_JIT
+    if (use_jit) {
+        jopt.unbuffered = out::unbuffered;
+        return jit::run(src->text(), optimize, args, jopt);
+    }
+#endif
+    e1_options opt;
+    e1_default_options(&opt);
+    opt.engine = engine == "ast" ? E1_ENGINE_AST
+               : engine == "closure" ? E1_ENGINE_CLOSURE
+               : engine == "baseline-jit" ? E1_ENGINE_BASELINE_JIT
+               : E1_ENGINE_VM;
+    opt.optimize = optimize;
+    opt.tier_up = hot;
+    opt.unbuffered = out::unbuffered;
+    opt.threads = threads;
+    e1_error err;
+    std::unique_ptr<e1_program, decltype(&e1_program_free)> prog(
+        e1_compile_with(src->text().data(), src->text().size(), &opt, &err), e1_program_free);
+    if (!prog) { std::println(stderr, "Error: {}", err.message); return 1; }
 
-    for (auto& s : *prog) {
-        try { exec(s.get(), env); }
-        catch (Break) { std::println(stderr, "Error: break_ifz outside loop"); break; }
+    int rc = 0;
+    if (table) rc = batch::run(*table, jobs, prog.get());
+    else {
+        // Malformed arguments are reported with their position (bad_arg exits)
+        args.resize(std::min<size_t>(args.size(), ARG_COUNT + 1));
+        for (size_t i = 1; i < args.size(); ++i)
+            if (auto* at = bigint::bad_digit(args[i])) bigint::bad_arg(args[i], at);
+        args.push_back(nullptr);
+        int st = e1_run(prog.get(), args.data() + 1, nullptr, nullptr);
+        if (st != E1_OK) std::println(stderr, "{}", e1_status_message(st));
+        rc = st == E1_FAILED;
     }
+    e1_flush();
+    return rc;
 }
@@ -1,16 +1,30 @@
-// PL/0 Level 1 — Shared lexer, AST, and parser (C++23)
+// PL/0 Levels 1-2 — Shared lexer, AST, and parser (C++23)
+//
+// The frontend does not copy the program text: read_file maps the file, the
+// lexer hands out tokens as views into it, one at a time as the parser asks
+// for them, and identifiers are interned to dense integer ids. The parser
+// builds a flat, index-linked AST in one arena (see Ast), which keeps views of
+// identifier spellings, so the Source must outlive it. Parse errors carry the
+// line and column of the offending token.
 #pragma once
 
-#include <iostream>
-#include <fstream>
-#include <sstream>
+#include <algorithm>
+#include <charconv>
 #include <string>
 #include <string_view>
 #include <vector>
 #include <memory>
+#include <span>
+#include <utility>
+#include <unordered_map>
 #include <expected>
 #include <print>
 #include <format>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 // ---------- Language Implementation Configuration ----------
 
@@ -23,6 +37,12 @@ constexpr int INT_BITS = 0;
 // Number of built-in arg<N> variables (arg1, arg2, ..., argN)
 constexpr int ARG_COUNT = 2;
 
+// Language level accepted by the frontend: 1 = e1, 2 = e2 (adds case, break,
+// comparisons, * / %; drops break_ifz). Override with -DLEVEL=2 (//src:e2).
+#ifndef LEVEL
+constexpr int LEVEL = 1;
+#endif
+
 // Integer type selection
 #include "e1_bigint.hpp"
 
@@ -32,17 +52,101 @@ template<int Bits> requires (Bits > 0) struct IntType<Bits> { using type = _BitI
 
 using Int = typename IntType<INT_BITS>::type;
 
+// Output one value per line through the shared output buffer (e1_out.hpp),
+// used by all interpreter engines
+inline void print_int(const Int& v) {
+#if INT_BITS == 0
+    v.str();
+#else
+    out::line(v);
+#endif
+}
+
+// ---------- Source ----------
+
+// Program text: a read-only mapping of the file, or an owned string for
+// programs that do not come from a file
+class Source {
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    bool mapped_ = false;
+    std::string owned_;
+
+    Source(const char* data, size_t size) : data_(data), size_(size), mapped_(true) {}
+    friend std::expected<Source, std::string> read_file(const char* path);
+
+public:
+    Source() = default;
+    explicit Source(std::string text) : owned_(std::move(text)) {}
+    Source(Source&& o) noexcept
+        : data_(std::exchange(o.data_, nullptr)), size_(o.size_), mapped_(std::exchange(o.mapped_, false)),
+          owned_(std::move(o.owned_)) {}
+    Source& operator=(Source&& o) noexcept {
+        std::swap(data_, o.data_);
+        std::swap(size_, o.size_);
+        std::swap(mapped_, o.mapped_);
+        std::swap(owned_, o.owned_);
+        return *this;
+    }
+    ~Source() {
+        if (mapped_) munmap(const_cast<char*>(data_), size_);
+    }
+
+    std::string_view text() const { return mapped_ ? std::string_view(data_, size_) : std::string_view(owned_); }
+};
+
 // ---------- Tokens ----------
 
-enum class Tok { NUM, ID, ASSIGN, COLON, PLUS, MINUS, LPAREN, RPAREN, LBRACE, RBRACE, LOOP, BREAK_IFZ, PRINT, SEMI, END };
+enum class Tok {
+    NUM, ID, ASSIGN, COLON, PLUS, MINUS, LPAREN, RPAREN, LBRACE, RBRACE, LOOP, BREAK_IFZ, PRINT, SEMI, END,
+    // e2
+    CASE, BREAK, ARROW, STAR, SLASH, PERCENT, EQ, NE, LT, GT, LE, GE,
+    ERROR,  // a character no token starts with
+};
+
+// `text` views the source; `id` is the interned identifier for Tok::ID
+struct Token { Tok type; std::string_view text; uint32_t id = 0; };
+
+// Spelling of the built-in argument variable argN (static storage)
+inline std::string_view arg_name(int n) {
+    static const auto names = [] {
+        std::vector<std::string> v;
+        for (int i = 1; i <= ARG_COUNT; ++i) v.push_back(std::format("arg{}", i));
+        return v;
+    }();
+    return names[n - 1];
+}
+
+// An interned identifier: ids are dense per program, in order of first
+// appearance in the source, with arg1..argN as 0..ARG_COUNT-1. `str` views
+// the spelling. Two Idents are the same variable iff their ids are equal.
+struct Ident {
+    uint32_t id = 0;
+    std::string_view str;
+    bool operator==(const Ident& o) const { return id == o.id; }
+};
+
+struct Interner {
+    std::unordered_map<std::string_view, uint32_t> ids;
+    std::vector<std::string_view> spellings;  // by id
 
-struct Token { Tok type; std::string val; };
+    Interner() {
+        for (int i = 1; i <= ARG_COUNT; ++i) intern(arg_name(i));
+    }
+    uint32_t intern(std::string_view s) {
+        auto [it, added] = ids.try_emplace(s, uint32_t(ids.size()));
+        if (added) spellings.push_back(s);
+        return it->second;
+    }
+};
 
 // ---------- Lexer ----------
 
 struct Lexer {
     std::string_view src;
+    int level = LEVEL;
     size_t pos = 0;
+    Interner names;
 
     char peek() const { return pos < src.size() ? src[pos] : '\0'; }
     char get() { return pos < src.size() ? src[pos++] : '\0'; }
@@ -56,176 +160,659 @@ struct Lexer {
         }
     }
 
-    std::expected<Token, std::string> next() {
+    Token token(Tok t, size_t start) const { return {t, src.substr(start, pos - start)}; }
+
+    // The next token; Tok::ERROR for a character no token starts with
+    Token next() {
         skip_ws();
+        size_t start = pos;
         char c = peek();
-        if (c == '\0') return Token{Tok::END, ""};
+        if (c == '\0') return token(Tok::END, start);
         if (isdigit(c)) {
-            size_t start = pos;
             while (isdigit(peek())) get();
-            return Token{Tok::NUM, std::string(src.substr(start, pos - start))};
+            return token(Tok::NUM, start);
         }
         if (isalpha(c) || c == '_') {
-            size_t start = pos;
             while (isalnum(peek()) || peek() == '_') get();
-            auto id = std::string(src.substr(start, pos - start));
-            if (id == "loop") return Token{Tok::LOOP, id};
-            if (id == "break_ifz") return Token{Tok::BREAK_IFZ, id};
-            if (id == "print") return Token{Tok::PRINT, id};
-            return Token{Tok::ID, id};
+            auto id = src.substr(start, pos - start);
+            if (id == "loop") return token(Tok::LOOP, start);
+            if (id == "print") return token(Tok::PRINT, start);
+            if (level < 2 && id == "break_ifz") return token(Tok::BREAK_IFZ, start);
+            if (level >= 2 && id == "case") return token(Tok::CASE, start);
+            if (level >= 2 && id == "break") return token(Tok::BREAK, start);
+            return {Tok::ID, id, names.intern(id)};
         }
         get();
         switch (c) {
-            case ':': if (peek() == '=') { get(); return Token{Tok::ASSIGN, ":="}; }
-                      return Token{Tok::COLON, ":"};
-            case '+': return Token{Tok::PLUS, "+"};
-            case '-': return Token{Tok::MINUS, "-"};
-            case '(': return Token{Tok::LPAREN, "("};
-            case ')': return Token{Tok::RPAREN, ")"};
-            case '{': return Token{Tok::LBRACE, "{"};
-            case '}': return Token{Tok::RBRACE, "}"};
-            case ';': return Token{Tok::SEMI, ";"};
-        }
-        return std::unexpected(std::format("Unknown char: {}", c));
+            case ':': if (peek() == '=') { get(); return token(Tok::ASSIGN, start); }
+                      return token(Tok::COLON, start);
+            case '+': return token(Tok::PLUS, start);
+            case '-': if (level >= 2 && peek() == '>') { get(); return token(Tok::ARROW, start); }
+                      return token(Tok::MINUS, start);
+            case '(': return token(Tok::LPAREN, start);
+            case ')': return token(Tok::RPAREN, start);
+            case '{': return token(Tok::LBRACE, start);
+            case '}': return token(Tok::RBRACE, start);
+            case ';': return token(Tok::SEMI, start);
+        }
+        if (level >= 2) {
+            bool eq = peek() == '=';
+            switch (c) {
+                case '*': return token(Tok::STAR, start);
+                case '/': return token(Tok::SLASH, start);
+                case '%': return token(Tok::PERCENT, start);
+                case '=': if (eq) { get(); return token(Tok::EQ, start); } break;
+                case '!': if (eq) { get(); return token(Tok::NE, start); } break;
+                case '<': if (eq) get(); return token(eq ? Tok::LE : Tok::LT, start);
+                case '>': if (eq) get(); return token(eq ? Tok::GE : Tok::GT, start);
+            }
+        }
+        return token(Tok::ERROR, start);
     }
-};
 
-inline auto tokenize(std::string_view src) {
-    Lexer l{src};
-    std::vector<Token> toks;
-    while (true) {
-        auto t = l.next();
-        if (!t) return std::expected<std::vector<Token>, std::string>(std::unexpected(t.error()));
-        toks.push_back(*t);
-        if (t->type == Tok::END) break;
+    // 1-based line and column of source offset `at`
+    std::pair<size_t, size_t> line_col(size_t at) const {
+        auto before = src.substr(0, at);
+        size_t nl = before.rfind('\n');
+        return {size_t(std::ranges::count(before, '\n')) + 1, at - (nl == std::string_view::npos ? 0 : nl + 1) + 1};
     }
-    return std::expected<std::vector<Token>, std::string>(std::move(toks));
-}
+};
 
 // ---------- AST ----------
 
-struct Expr { virtual ~Expr() = default; };
-struct Stmt { virtual ~Stmt() = default; };
+// The AST is flat: nodes live in one Ast arena and refer to each other by
+// 32-bit index, with every field in its own array (structure of arrays). A
+// node costs 10 bytes and a program is a few large allocations however many
+// nodes it has. Consumers switch on kind(n) and read that kind's fields:
+//
+//   Num       val                         literal
+//   Var       name, slot                  variable read
+//   Neg       kid                         operand
+//   Bin       op, lhs, rhs
+//   Decl      name, slot
+//   Assign    name, slot, kid, op         kid is the value; op 'm': a move
+//                                         (see mark_moves)
+//   Block     items                       statements
+//   Loop      kid                         body
+//   BreakIfz  kid                         condition
+//   Print     kid
+//   Case      items                       its Arms (e2)
+//   Arm       guard, kid                  kid is the body (e2)
+//   Break                                 exits the innermost loop (e2)
+//   MulAdd    op, loop, acc, count, step  counted loop (see below)
+//
+// The program is the Block `root`. Bin's op is the operator character:
+// + - (e1), * / % < > (e2), and for the other e2 comparisons '=' (==),
+// '!' (!=), 'l' (<=), 'g' (>=).
+//
+// MulAdd is built by the optimizer (e1_opt.hpp) from
+//   loop { break_ifz n  acc := acc ± e  n := n - 1 }
+// with e reading neither acc nor n, or from the bare countdown without acc.
+// For n >= 0 it runs as acc := acc ± n * e followed by n := 0; a negative n
+// never counts down to zero, so the original loop runs instead. acc and
+// count are the Assign nodes in that loop and step is e; acc and step are
+// NO_NODE for a countdown. op is '+' or '-'.
+enum class Kind : uint8_t { Num, Var, Neg, Bin, Decl, Assign, Block, Loop, BreakIfz, Print, Case, Arm, Break, MulAdd };
+
+using Node = uint32_t;
+constexpr Node NO_NODE = UINT32_MAX;
+
+struct Ast {
+    // Per node. x: Num value, identifier id (Var, Decl, Assign), lhs, guard,
+    // or the start of the node's run in `lists` (Block, Case, MulAdd).
+    // y: kid, rhs, or the length of that run.
+    std::vector<Kind> kinds;
+    std::vector<char> ops;
+    std::vector<uint32_t> xs, ys;
+    std::vector<Node> lists;                  // children of Block, Case and MulAdd
+    std::vector<std::string_view> spellings;  // by identifier id (views of the Source)
+    std::vector<int> slots;                   // by identifier id, filled in by resolve()
+    Node root = NO_NODE;
 
-using ExprPtr = std::unique_ptr<Expr>;
-using StmtPtr = std::unique_ptr<Stmt>;
+    Kind kind(Node n) const { return kinds[n]; }
+    char op(Node n) const { return ops[n]; }
+    int val(Node n) const { return int(xs[n]); }
+    uint32_t id(Node n) const { return xs[n]; }
+    Ident name(Node n) const { return {xs[n], spellings[xs[n]]}; }
+    int slot(Node n) const { return slots[xs[n]]; }
+    Node kid(Node n) const { return ys[n]; }
+    Node lhs(Node n) const { return xs[n]; }
+    Node rhs(Node n) const { return ys[n]; }
+    Node guard(Node n) const { return xs[n]; }
+    std::span<const Node> items(Node n) const { return {lists.data() + xs[n], ys[n]}; }
+    std::span<Node> items(Node n) { return {lists.data() + xs[n], ys[n]}; }
+    Node loop(Node n) const { return lists[xs[n]]; }
+    Node acc(Node n) const { return lists[xs[n] + 1]; }
+    Node count(Node n) const { return lists[xs[n] + 2]; }
+    Node step(Node n) const { return lists[xs[n] + 3]; }
 
-struct NumberExpr : Expr { int val; NumberExpr(int v) : val(v) {} };
-struct VarExpr : Expr { std::string name; VarExpr(std::string n) : name(std::move(n)) {} };
-struct NegExpr : Expr { ExprPtr e; NegExpr(ExprPtr x) : e(std::move(x)) {} };
-struct BinExpr : Expr {
-    char op; ExprPtr l, r;
-    BinExpr(char o, ExprPtr a, ExprPtr b) : op(o), l(std::move(a)), r(std::move(b)) {}
+    // --- Building and rewriting (parser, optimizer) ---
+
+    Node add(Kind k, uint32_t x = 0, uint32_t y = 0, char op = 0) {
+        kinds.push_back(k);
+        ops.push_back(op);
+        xs.push_back(x);
+        ys.push_back(y);
+        return Node(kinds.size() - 1);
+    }
+    // Appends a run of children; returns its start (the parent's x)
+    uint32_t add_list(std::span<const Node> ns) {
+        lists.insert(lists.end(), ns.begin(), ns.end());
+        return uint32_t(lists.size() - ns.size());
+    }
+    Node copy(Node n) { return add(kinds[n], xs[n], ys[n], ops[n]); }
+    // Rewrites n in place, so whatever refers to n sees the new node
+    void set(Node n, Kind k, uint32_t x = 0, uint32_t y = 0, char op = 0) {
+        kinds[n] = k;
+        ops[n] = op;
+        xs[n] = x;
+        ys[n] = y;
+    }
+    // n takes over the fields (and so the children) of `from`, which is left
+    // unreferenced
+    void replace(Node n, Node from) { set(n, kinds[from], xs[from], ys[from], ops[from]); }
+    // Keeps the first `len` items of a Block or Case
+    void shrink(Node n, size_t len) { ys[n] = uint32_t(len); }
 };
 
-struct DeclStmt : Stmt { std::string name; DeclStmt(std::string n) : name(std::move(n)) {} };
-struct AssignStmt : Stmt { std::string name; ExprPtr e; AssignStmt(std::string n, ExprPtr x) : name(std::move(n)), e(std::move(x)) {} };
-struct BlockStmt : Stmt { std::vector<StmtPtr> stmts; };
-struct LoopStmt : Stmt { StmtPtr body; LoopStmt(StmtPtr b) : body(std::move(b)) {} };
-struct BreakIfzStmt : Stmt { ExprPtr cond; BreakIfzStmt(ExprPtr c) : cond(std::move(c)) {} };
-struct PrintStmt : Stmt { ExprPtr e; PrintStmt(ExprPtr x) : e(std::move(x)) {} };
+inline bool is_cmp(char op) { return op == '=' || op == '!' || op == '<' || op == '>' || op == 'l' || op == 'g'; }
+
+// Source spelling of a Bin operator (also the C++ spelling)
+inline const char* op_str(char op) {
+    switch (op) {
+        case '=': return "==";
+        case '!': return "!=";
+        case 'l': return "<=";
+        case 'g': return ">=";
+        case '+': return "+"; case '-': return "-"; case '*': return "*";
+        case '/': return "/"; case '%': return "%"; case '<': return "<"; case '>': return ">";
+    }
+    return "?";
+}
+
+// Statement completion status used by the engines: Break leaves the innermost
+// loop (break_ifz fired, or an e2 break ran), so loop exits are plain returns
+// rather than exceptions.
+enum class Flow : bool { Next, Break };
+
+// ---------- e2 Arithmetic ----------
+
+// Division is Euclidean (0 <= a % b < |b|), and x / 0 = x % 0 = 0 as in e2peg.
+// bigint::Int's / and % implement exactly this; _BitInt truncates, so the
+// quotient and remainder are adjusted when the remainder is negative.
+inline Int ediv(const Int& a, const Int& b) {
+#if INT_BITS == 0
+    return a / b;
+#else
+    if (b == 0) return 0;
+    Int q = a / b;
+    if (a % b < 0) q += b > 0 ? -1 : 1;
+    return q;
+#endif
+}
+
+inline Int emod(const Int& a, const Int& b) {
+#if INT_BITS == 0
+    return a % b;
+#else
+    if (b == 0) return 0;
+    Int r = a % b;
+    if (r < 0) r += b > 0 ? b : -b;
+    return r;
+#endif
+}
+
+// Any Bin operator; comparisons yield 1 or 0
+inline Int binop(char op, const Int& a, const Int& b) {
+    switch (op) {
+        case '+': return a + b;
+        case '-': return a - b;
+        case '*': return a * b;
+        case '/': return ediv(a, b);
+        case '%': return emod(a, b);
+        case '=': return Int(a == b);
+        case '!': return Int(a != b);
+        case '<': return Int(a < b);
+        case '>': return Int(a > b);
+        case 'l': return Int(a <= b);
+        case 'g': return Int(a >= b);
+    }
+    return Int(0);
+}
+
+// acc := acc ± n * e for a MulAdd node. Fixed-width values wrap through the
+// unsigned type, so the result is that of the n additions it replaces.
+inline void mul_add(Int& acc, char op, const Int& n, const Int& e) {
+#if INT_BITS == 0
+    acc.mul_add(n, e, op == '-');
+#else
+    using U = unsigned _BitInt(INT_BITS);
+    U p = U(n) * U(e);
+    acc = Int(op == '+' ? U(acc) + p : U(acc) - p);
+#endif
+}
+
+// x := y for a move (see mark_moves): bigints exchange their storage, so y
+// is left with x's old value
+inline void move_int(Int& x, Int& y) {
+#if INT_BITS == 0
+    swap(x, y);
+#else
+    x = y;
+#endif
+}
+
+// dst := Σ ±*t[i].v for an n-ary sum (see sum_terms); an operand may be dst.
+// Bigints add all operands in one pass over the limbs (bigint::sum), fixed
+// widths wrap through the unsigned type like the additions they replace.
+#if INT_BITS == 0
+using SumTerm = bigint::Int::Term;
+#else
+struct SumTerm { const Int* v; bool sub; };
+#endif
+
+inline void sum(Int& dst, const SumTerm* t, uint32_t k) {
+#if INT_BITS == 0
+    dst.set_sum(t, k);
+#else
+    using U = unsigned _BitInt(INT_BITS);
+    U s = 0;
+    for (uint32_t i = 0; i < k; i++) s = t[i].sub ? s - U(*t[i].v) : s + U(*t[i].v);
+    dst = Int(s);
+#endif
+}
 
 // ---------- Parser ----------
 
+// Reads tokens from the lexer on demand, one token of lookahead, and builds
+// the Ast bottom-up
 struct Parser {
-    std::vector<Token> toks;
-    size_t pos = 0;
+    Lexer lex;
+    Token tok;  // current token
+    Ast ast;
+    std::vector<Node> pending;  // statements of the enclosing blocks, innermost last
 
-    Tok type() const { return pos < toks.size() ? toks[pos].type : Tok::END; }
-    const std::string& val() const { static std::string empty; return pos < toks.size() ? toks[pos].val : empty; }
-    void advance() { if (pos < toks.size()) pos++; }
+    Parser(std::string_view src, int level) : lex{src, level} { advance(); }
+
+    Tok type() const { return tok.type; }
+    void advance() { tok = lex.next(); }
     bool match(Tok t) { if (type() == t) { advance(); return true; } return false; }
 
-    std::expected<ExprPtr, std::string> parse_atom() {
-        if (type() == Tok::NUM) { int v = std::stoi(val()); advance(); return std::make_unique<NumberExpr>(v); }
-        if (type() == Tok::ID) { auto n = val(); advance(); return std::make_unique<VarExpr>(n); }
+    // "line:col: msg" at the current token (an unknown character there
+    // takes precedence over what the parser expected)
+    std::unexpected<std::string> error(std::string_view msg) const {
+        auto [line, col] = lex.line_col(size_t(tok.text.data() - lex.src.data()));
+        if (tok.type == Tok::ERROR) return std::unexpected(std::format("{}:{}: Unknown char: {}", line, col, tok.text));
+        return std::unexpected(std::format("{}:{}: {}", line, col, msg));
+    }
+
+    // A Block or Case of the nodes pending since `base`, which it pops
+    Node list(Kind k, size_t base) {
+        auto n = ast.add(k, ast.add_list(std::span(pending).subspan(base)), uint32_t(pending.size() - base));
+        pending.resize(base);
+        return n;
+    }
+
+    std::expected<Node, std::string> parse_atom() {
+        if (type() == Tok::NUM) {
+            int v;
+            auto [end, ec] = std::from_chars(tok.text.data(), tok.text.data() + tok.text.size(), v);
+            if (ec != std::errc{}) return error("Number out of range");
+            advance();
+            return ast.add(Kind::Num, uint32_t(v));
+        }
+        if (type() == Tok::ID) { auto id = tok.id; advance(); return ast.add(Kind::Var, id); }
         if (match(Tok::LPAREN)) {
-            auto e = parse_sum();
+            auto e = parse_expr();
             if (!e) return e;
-            if (!match(Tok::RPAREN)) return std::unexpected("Expected ')'");
+            if (!match(Tok::RPAREN)) return error("Expected ')'");
             return e;
         }
-        return std::unexpected("Expected atom");
+        return error("Expected atom");
     }
 
-    std::expected<ExprPtr, std::string> parse_unary() {
+    std::expected<Node, std::string> parse_unary() {
         if (match(Tok::MINUS)) {
             auto e = parse_atom();
             if (!e) return e;
-            return std::make_unique<NegExpr>(std::move(*e));
+            return ast.add(Kind::Neg, 0, *e);
         }
         return parse_atom();
     }
 
-    std::expected<ExprPtr, std::string> parse_sum() {
+    // e2 binds * / % tighter than + -; in e1 a product is just a unary
+    std::expected<Node, std::string> parse_product() {
         auto left = parse_unary();
         if (!left) return left;
-        while (type() == Tok::PLUS || type() == Tok::MINUS) {
-            char op = val()[0]; advance();
+        while (type() == Tok::STAR || type() == Tok::SLASH || type() == Tok::PERCENT) {
+            char op = tok.text[0]; advance();
             auto right = parse_unary();
             if (!right) return right;
-            left = std::make_unique<BinExpr>(op, std::move(*left), std::move(*right));
+            left = ast.add(Kind::Bin, *left, *right, op);
+        }
+        return left;
+    }
+
+    std::expected<Node, std::string> parse_sum() {
+        auto left = parse_product();
+        if (!left) return left;
+        while (type() == Tok::PLUS || type() == Tok::MINUS) {
+            char op = tok.text[0]; advance();
+            auto right = parse_product();
+            if (!right) return right;
+            left = ast.add(Kind::Bin, *left, *right, op);
         }
         return left;
     }
 
-    std::expected<StmtPtr, std::string> parse_stmt() {
+    // e2 comparisons do not chain: at most one per sum, yielding 1 or 0
+    std::expected<Node, std::string> parse_expr() {
+        auto left = parse_sum();
+        if (!left) return left;
+        char op;
+        switch (type()) {
+            case Tok::EQ: op = '='; break;
+            case Tok::NE: op = '!'; break;
+            case Tok::LT: op = '<'; break;
+            case Tok::GT: op = '>'; break;
+            case Tok::LE: op = 'l'; break;
+            case Tok::GE: op = 'g'; break;
+            default: return left;
+        }
+        advance();
+        auto right = parse_sum();
+        if (!right) return right;
+        return ast.add(Kind::Bin, *left, *right, op);
+    }
+
+    std::expected<Node, std::string> parse_stmt() {
         if (type() == Tok::ID) {
-            auto name = val(); advance();
+            auto id = tok.id; advance();
             if (match(Tok::ASSIGN)) {
-                auto e = parse_sum();
-                if (!e) return std::unexpected(e.error());
-                return std::make_unique<AssignStmt>(name, std::move(*e));
+                auto e = parse_expr();
+                if (!e) return e;
+                return ast.add(Kind::Assign, id, *e);
             }
-            if (match(Tok::COLON)) return std::make_unique<DeclStmt>(name);
-            return std::unexpected("Expected ':=' or ':'");
+            if (match(Tok::COLON)) return ast.add(Kind::Decl, id);
+            return error("Expected ':=' or ':'");
         }
         if (match(Tok::LOOP)) {
             auto body = parse_stmt();
             if (!body) return body;
-            return std::make_unique<LoopStmt>(std::move(*body));
+            return ast.add(Kind::Loop, 0, *body);
         }
         if (match(Tok::BREAK_IFZ)) {
-            auto c = parse_sum();
-            if (!c) return std::unexpected(c.error());
-            return std::make_unique<BreakIfzStmt>(std::move(*c));
+            auto c = parse_expr();
+            if (!c) return c;
+            return ast.add(Kind::BreakIfz, 0, *c);
+        }
+        if (match(Tok::BREAK)) return ast.add(Kind::Break);
+        if (match(Tok::CASE)) {
+            if (!match(Tok::LBRACE)) return error("Expected '{' after case");
+            size_t base = pending.size();
+            do {
+                auto c = parse_expr();
+                if (!c) return c;
+                if (!match(Tok::ARROW)) return error("Expected '->'");
+                auto body = parse_stmt();
+                if (!body) return body;
+                pending.push_back(ast.add(Kind::Arm, *c, *body));
+            } while (!match(Tok::RBRACE));
+            return list(Kind::Case, base);
         }
         if (match(Tok::PRINT)) {
-            auto e = parse_sum();
-            if (!e) return std::unexpected(e.error());
-            return std::make_unique<PrintStmt>(std::move(*e));
+            auto e = parse_expr();
+            if (!e) return e;
+            return ast.add(Kind::Print, 0, *e);
         }
         if (match(Tok::LBRACE)) {
-            auto block = std::make_unique<BlockStmt>();
+            size_t base = pending.size();
             while (!match(Tok::RBRACE)) {
                 auto s = parse_stmt();
                 if (!s) return s;
-                block->stmts.push_back(std::move(*s));
+                pending.push_back(*s);
                 match(Tok::SEMI);
             }
-            return block;
+            return list(Kind::Block, base);
         }
-        return std::unexpected("Expected statement");
+        return error("Expected statement");
     }
 };
 
+// ---------- Move Assignments ----------
+
+// Marks `x := y` (y another variable) as a move, op 'm', when y is dead
+// after it: no path from there reads y before assigning it. Engines and
+// backends then exchange the storage of x and y instead of copying y's
+// limbs, so y is left holding x's old value, which nothing reads.
+//
+// Backward liveness over the structured program, one bit per identifier id.
+// A loop's head set is iterated to its fixed point and kept between visits,
+// so nested loops converge without starting over; every Assign is marked on
+// its last visit, which sees the final sets. Nothing is live at the end of
+// the program or after a break outside any loop.
+struct Liveness {
+    using Set = std::vector<bool>;
+
+    Ast& a;
+    std::unordered_map<Node, Set> heads;  // per Loop: live at its head
+    std::unordered_map<Node, Set> outs;   // per Loop: live after it
+
+    void uses(Node e, Set& live) const {
+        switch (a.kind(e)) {
+        case Kind::Var: live[a.id(e)] = true; break;
+        case Kind::Neg: uses(a.kid(e), live); break;
+        case Kind::Bin: uses(a.lhs(e), live); uses(a.rhs(e), live); break;
+        default: break;
+        }
+    }
+
+    // into |= from; false if that added nothing
+    static bool merge(Set& into, const Set& from) {
+        bool grew = false;
+        for (size_t i = 0; i < into.size(); ++i)
+            if (from[i] && !into[i]) into[i] = grew = true;
+        return grew;
+    }
+
+    // Live before s, given `live` after it and `brk` after the innermost loop
+    Set before(Node s, Set live, const Set& brk) {
+        switch (a.kind(s)) {
+        case Kind::Assign: {
+            Node v = a.kid(s);
+            bool move = a.kind(v) == Kind::Var && a.id(v) != a.id(s) && !live[a.id(v)];
+            a.ops[s] = move ? 'm' : 0;
+            live[a.id(s)] = false;
+            uses(v, live);
+            break;
+        }
+        case Kind::Block: {
+            auto items = a.items(s);
+            for (size_t i = items.size(); i-- > 0;) live = before(items[i], std::move(live), brk);
+            break;
+        }
+        case Kind::Loop: {
+            outs[s] = live;
+            Set& head = heads.try_emplace(s, live.size()).first->second;
+            while (merge(head, before(a.kid(s), head, live))) {}
+            return head;
+        }
+        case Kind::BreakIfz: merge(live, brk); uses(a.kid(s), live); break;
+        case Kind::Print: uses(a.kid(s), live); break;
+        case Kind::Break: return brk;
+        case Kind::Case: {
+            // From the last arm back: guard, then its body or the arms after it
+            auto arms = a.items(s);
+            Set next = live;
+            for (size_t i = arms.size(); i-- > 0;) {
+                Set in = before(a.kid(arms[i]), live, brk);
+                merge(in, next);
+                uses(a.guard(arms[i]), in);
+                next = std::move(in);
+            }
+            return next;
+        }
+        case Kind::MulAdd: {
+            // Either path: the original loop, or the closed form
+            Set in = before(a.loop(s), live, brk);
+            merge(in, live);
+            in[a.id(a.count(s))] = true;
+            if (a.acc(s) != NO_NODE) {
+                in[a.id(a.acc(s))] = true;
+                uses(a.step(s), in);
+            }
+            return in;
+        }
+        default: break;  // Decl
+        }
+        return live;
+    }
+};
+
+inline void mark_moves(Ast& a) {
+    Liveness::Set none(a.spellings.size());
+    Liveness{a}.before(a.root, none, none);
+}
+
+// ---------- Symbol Resolution ----------
+
+// Every variable gets a dense slot: arg1..argN are slots 0..ARG_COUNT-1, the
+// others follow in order of first occurrence (right-hand sides before the
+// assigned name). The numbering is deterministic, so engines can use a flat
+// register file and backends emit variables in a stable order.
+struct Symbol {
+    std::string name;
+    bool declared = false;    // has an explicit `x:` declaration
+    bool read_first = false;  // first occurrence is a read (relies on the initial 0)
+};
+
+struct Symbols {
+    std::vector<Symbol> syms;
+    std::vector<int> by_id;  // interned id -> slot, -1 if not seen yet
+
+    Symbols() {
+        for (int i = 1; i <= ARG_COUNT; ++i) slot(Ident{uint32_t(i - 1), arg_name(i)});
+    }
+    size_t size() const { return syms.size(); }
+    const Symbol& operator[](int s) const { return syms[s]; }
+    static bool is_arg(int s) { return s < ARG_COUNT; }
+
+    // Slot of `name`, allocating one on first sight; `fresh` reports that case
+    int slot(Ident name, bool* fresh = nullptr) {
+        if (name.id >= by_id.size()) by_id.resize(name.id + 1, -1);
+        int& s = by_id[name.id];
+        bool added = s < 0;
+        if (added) {
+            s = int(syms.size());
+            syms.push_back({std::string(name.str)});
+        }
+        if (fresh) *fresh = added;
+        return s;
+    }
+};
+
+inline void resolve(const Ast& a, Node n, Symbols& st) {
+    switch (a.kind(n)) {
+    case Kind::Var: {
+        bool fresh;
+        int s = st.slot(a.name(n), &fresh);
+        if (fresh) st.syms[s].read_first = true;
+        break;
+    }
+    case Kind::Decl: st.syms[st.slot(a.name(n))].declared = true; break;
+    case Kind::Assign: resolve(a, a.kid(n), st); st.slot(a.name(n)); break;
+    case Kind::Neg: case Kind::Loop: case Kind::BreakIfz: case Kind::Print: resolve(a, a.kid(n), st); break;
+    case Kind::Bin: resolve(a, a.lhs(n), st); resolve(a, a.rhs(n), st); break;
+    case Kind::Arm: resolve(a, a.guard(n), st); resolve(a, a.kid(n), st); break;
+    case Kind::Block: case Kind::Case: for (auto s : a.items(n)) resolve(a, s, st); break;
+    case Kind::MulAdd: resolve(a, a.loop(n), st); break;
+    case Kind::Num: case Kind::Break: break;
+    }
+}
+
+// Annotate a parsed program with slots and moves; returns the symbol table
+inline Symbols resolve(Ast& a) {
+    Symbols st;
+    resolve(a, a.root, st);
+    a.slots = st.by_id;
+    a.slots.resize(a.spellings.size(), -1);  // names the optimizer removed
+    mark_moves(a);
+    return st;
+}
+
+// ---------- Pattern Helpers ----------
+
+// Self-update `x := x + e`, `x := x - e` or `x := e + x` (Assign node n):
+// returns e and sets *op to '+' or '-', so engines can update x in place;
+// NO_NODE otherwise. Compares identifier ids, so it works before resolve().
+inline Node self_update(const Ast& a, Node n, char* op) {
+    Node b = a.kid(n);
+    if (a.kind(b) != Kind::Bin || (a.op(b) != '+' && a.op(b) != '-')) return NO_NODE;
+    *op = a.op(b);
+    auto is_x = [&](Node v) { return a.kind(v) == Kind::Var && a.id(v) == a.id(n); };
+    if (is_x(a.lhs(b))) return a.rhs(b);
+    if (is_x(a.rhs(b)) && *op == '+') return a.lhs(b);
+    return NO_NODE;
+}
+
+// One operand of an n-ary sum: +x, or -x if sub
+struct Addend { Node x; bool sub; };
+
+// Flattens a tree of + and - (through unary minus) into its operands, so
+// engines can add them in one step: `n + n + n + 1` or `a - (b + -c)` =
+// a - b + c. Returns false, leaving `out` empty, for anything but a + or -
+// with at least three operands (a single + or - keeps its own code).
+inline bool sum_terms(const Ast& a, Node x, std::vector<Addend>& out) {
+    out.clear();
+    if (a.kind(x) != Kind::Bin || (a.op(x) != '+' && a.op(x) != '-')) return false;
+    auto walk = [&](auto& self, Node y, bool sub) -> void {
+        if (a.kind(y) == Kind::Bin && (a.op(y) == '+' || a.op(y) == '-')) {
+            self(self, a.lhs(y), sub);
+            self(self, a.rhs(y), sub != (a.op(y) == '-'));
+        } else if (a.kind(y) == Kind::Neg) self(self, a.kid(y), !sub);
+        else out.push_back({y, sub});
+    };
+    walk(walk, x, false);
+    if (out.size() < 3) out.clear();
+    return !out.empty();
+}
+
 // ---------- Utilities ----------
 
-inline std::string read_file(const char* path) {
-    std::ifstream f(path);
-    std::stringstream ss; ss << f.rdbuf();
-    return ss.str();
+// Maps a regular file read-only (other files, e.g. pipes, are read into
+// memory); the Source must outlive the AST parsed from it
+inline std::expected<Source, std::string> read_file(const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return std::unexpected(std::format("cannot open {}", path));
+    struct stat st;
+    if (fstat(fd, &st) != 0) { close(fd); return std::unexpected(std::format("cannot stat {}", path)); }
+    if (!S_ISREG(st.st_mode)) {
+        std::string text;
+        char buf[1 << 16];
+        for (ssize_t n; (n = read(fd, buf, sizeof buf)) != 0;) {
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0) { close(fd); return std::unexpected(std::format("cannot read {}", path)); }
+            text.append(buf, size_t(n));
+        }
+        close(fd);
+        return Source(std::move(text));
+    }
+    auto size = size_t(st.st_size);
+    void* data = size ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : nullptr;
+    close(fd);
+    if (data == MAP_FAILED) return std::unexpected(std::format("cannot map {}", path));
+    if (!data) return Source();
+    return Source(static_cast<const char*>(data), size);
 }
 
-inline auto parse_program(std::string_view src) {
-    auto toks = tokenize(src);
-    if (!toks) return std::expected<std::vector<StmtPtr>, std::string>(std::unexpected(toks.error()));
-    Parser p{std::move(*toks)};
-    std::vector<StmtPtr> prog;
+inline std::expected<Ast, std::string> parse_program(std::string_view src, int level = LEVEL) {
+    Parser p{src, level};
     while (p.type() != Tok::END) {
         auto s = p.parse_stmt();
-        if (!s) return std::expected<std::vector<StmtPtr>, std::string>(std::unexpected(s.error()));
-        prog.push_back(std::move(*s));
+        if (!s) return std::unexpected(s.error());
+        p.pending.push_back(*s);
     }
-    return std::expected<std::vector<StmtPtr>, std::string>(std::move(prog));
+    p.ast.root = p.list(Kind::Block, 0);
+    p.ast.spellings = std::move(p.lex.names.spellings);
+    return std::move(p.ast);
 }
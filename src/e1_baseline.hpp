@@ -0,0 +1,279 @@
+// PL/0 Levels 1-2 — Copy-and-patch baseline JIT (--engine=baseline-jit)
+//
+// A native-code tier without a compiler backend: every bytecode instruction
+// of e1_vm.hpp is translated by copying a precompiled x86-64 machine-code
+// stencil into executable memory and patching its holes (register
+// displacements, helper addresses, branch targets). Translation is one linear
+// pass, so even small scripts pay almost nothing before they run; the code
+// has no dispatch or operand decoding left, only the operations themselves.
+//
+// Generated code keeps the register file base in rbx and works on the same
+// Int registers as the VM:
+//   - arithmetic, print and counted-loop instructions call a helper with the
+//     operand addresses in rdi, rsi, rdx (bigint values need the library);
+//     SUM passes its destination, its operand run and the register file
+//   - PAR (a parallel loop) passes its counter, its reduction and the
+//     register file, and branches past the loop if the helper ran it
+//   - conditional jumps call a predicate helper and branch on its result
+//   - JMP, HALT and BRKERR are plain jumps and returns
+// Fixed 64-bit builds (INT_BITS=64) use stencils that do the arithmetic and
+// comparisons inline instead of calling a helper.
+//
+// Every instruction starts at a known offset, so execution can enter at any
+// bytecode pc with the registers the VM left: --tier-up runs the VM until a
+// loop has iterated `hot` times, then continues that loop here (on-stack
+// replacement is trivial because all state lives in the register file).
+//
+// x86-64 Linux only; elsewhere translate() reports an error.
+#pragma once
+#include "e1_vm.hpp"
+#include <cerrno>
+#include <cstring>
+#if defined(__x86_64__) && defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+namespace baseline {
+
+// --- Stencils ---
+
+// Hole kinds: A/B/C are disp32 register offsets (slot * sizeof(Int)), FN an
+// absolute helper address (imm64), TARGET a rel32 branch to bytecode pc c,
+// RUN the address of a SUM's operand run, &terms[b] (imm64), RED that of a
+// PAR's reduction, &reduces[b] (imm64).
+enum Hole : uint8_t { A, B, C, FN, TARGET, RUN, RED };
+
+struct Stencil {
+    std::initializer_list<uint8_t> code;
+    std::initializer_list<std::pair<uint8_t, Hole>> holes;  // (byte offset, kind)
+};
+
+// Entry: push rbx (aligns the stack for helper calls); rbx := regs; jmp at
+inline constexpr Stencil prologue = {{0x53, 0x48, 0x89, 0xFB, 0xFF, 0xE6}, {}};
+
+// helper(&r[a], &r[b], &r[c])
+//   lea rdi, [rbx+A]; lea rsi, [rbx+B]; lea rdx, [rbx+C]; mov rax, FN; call rax
+inline constexpr Stencil call = {
+    {0x48, 0x8D, 0xBB, 0, 0, 0, 0, 0x48, 0x8D, 0xB3, 0, 0, 0, 0, 0x48, 0x8D, 0x93, 0, 0, 0, 0,
+     0x48, 0xB8, 0, 0, 0, 0, 0, 0, 0, 0, 0xFF, 0xD0},
+    {{3, A}, {10, B}, {17, C}, {23, FN}}};
+
+// if (helper(&r[a], &r[b], &r[c])) goto TARGET
+//   <call>; test al, al; jnz TARGET
+inline constexpr Stencil branch = {
+    {0x48, 0x8D, 0xBB, 0, 0, 0, 0, 0x48, 0x8D, 0xB3, 0, 0, 0, 0, 0x48, 0x8D, 0x93, 0, 0, 0, 0,
+     0x48, 0xB8, 0, 0, 0, 0, 0, 0, 0, 0, 0xFF, 0xD0, 0x84, 0xC0, 0x0F, 0x85, 0, 0, 0, 0},
+    {{3, A}, {10, B}, {17, C}, {23, FN}, {37, TARGET}}};
+
+// helper(&r[a], run, r) for SUM
+//   lea rdi, [rbx+A]; mov rsi, RUN; mov rdx, rbx; mov rax, FN; call rax
+inline constexpr Stencil call_run = {
+    {0x48, 0x8D, 0xBB, 0, 0, 0, 0, 0x48, 0xBE, 0, 0, 0, 0, 0, 0, 0, 0, 0x48, 0x89, 0xDA,
+     0x48, 0xB8, 0, 0, 0, 0, 0, 0, 0, 0, 0xFF, 0xD0},
+    {{3, A}, {9, RUN}, {22, FN}}};
+
+// if (helper(&r[a], red, r)) goto TARGET for PAR
+//   lea rdi, [rbx+A]; mov rsi, RED; mov rdx, rbx; mov rax, FN; call rax; test al, al; jnz TARGET
+inline constexpr Stencil branch_red = {
+    {0x48, 0x8D, 0xBB, 0, 0, 0, 0, 0x48, 0xBE, 0, 0, 0, 0, 0, 0, 0, 0, 0x48, 0x89, 0xDA,
+     0x48, 0xB8, 0, 0, 0, 0, 0, 0, 0, 0, 0xFF, 0xD0, 0x84, 0xC0, 0x0F, 0x85, 0, 0, 0, 0},
+    {{3, A}, {9, RED}, {22, FN}, {36, TARGET}}};
+
+inline constexpr Stencil jmp = {{0xE9, 0, 0, 0, 0}, {{1, TARGET}}};
+// mov eax, 1 / xor eax, eax; pop rbx; ret
+inline constexpr Stencil halt = {{0xB8, 1, 0, 0, 0, 0x5B, 0xC3}, {}};
+inline constexpr Stencil brkerr = {{0x31, 0xC0, 0x5B, 0xC3}, {}};
+
+#if INT_BITS == 64
+// Inline 64-bit stencils (rax is the scratch register)
+namespace inl {
+// mov rax, [rbx+B]; mov [rbx+A], rax
+inline constexpr Stencil mov = {{0x48, 0x8B, 0x83, 0, 0, 0, 0, 0x48, 0x89, 0x83, 0, 0, 0, 0}, {{3, B}, {10, A}}};
+// mov rax, [rbx+B]; add/sub rax, [rbx+C]; mov [rbx+A], rax
+inline constexpr Stencil add = {{0x48, 0x8B, 0x83, 0, 0, 0, 0, 0x48, 0x03, 0x83, 0, 0, 0, 0, 0x48, 0x89, 0x83, 0, 0, 0, 0},
+                            {{3, B}, {10, C}, {17, A}}};
+inline constexpr Stencil sub = {{0x48, 0x8B, 0x83, 0, 0, 0, 0, 0x48, 0x2B, 0x83, 0, 0, 0, 0, 0x48, 0x89, 0x83, 0, 0, 0, 0},
+                            {{3, B}, {10, C}, {17, A}}};
+// mov rax, [rbx+B]; neg rax; mov [rbx+A], rax
+inline constexpr Stencil neg = {{0x48, 0x8B, 0x83, 0, 0, 0, 0, 0x48, 0xF7, 0xD8, 0x48, 0x89, 0x83, 0, 0, 0, 0},
+                            {{3, B}, {13, A}}};
+// mov rax, [rbx+B]; add/sub [rbx+A], rax
+inline constexpr Stencil addto = {{0x48, 0x8B, 0x83, 0, 0, 0, 0, 0x48, 0x01, 0x83, 0, 0, 0, 0}, {{3, B}, {10, A}}};
+inline constexpr Stencil subfrom = {{0x48, 0x8B, 0x83, 0, 0, 0, 0, 0x48, 0x29, 0x83, 0, 0, 0, 0}, {{3, B}, {10, A}}};
+// cmp qword [rbx+A], 0; je/jl TARGET
+inline constexpr Stencil jz = {{0x48, 0x83, 0xBB, 0, 0, 0, 0, 0, 0x0F, 0x84, 0, 0, 0, 0}, {{3, A}, {10, TARGET}}};
+inline constexpr Stencil jneg = {{0x48, 0x83, 0xBB, 0, 0, 0, 0, 0, 0x0F, 0x8C, 0, 0, 0, 0}, {{3, A}, {10, TARGET}}};
+// mov rax, [rbx+A]; cmp rax, [rbx+B]; je/jne TARGET
+inline constexpr Stencil jeq = {{0x48, 0x8B, 0x83, 0, 0, 0, 0, 0x48, 0x3B, 0x83, 0, 0, 0, 0, 0x0F, 0x84, 0, 0, 0, 0},
+                            {{3, A}, {10, B}, {16, TARGET}}};
+inline constexpr Stencil jne = {{0x48, 0x8B, 0x83, 0, 0, 0, 0, 0x48, 0x3B, 0x83, 0, 0, 0, 0, 0x0F, 0x85, 0, 0, 0, 0},
+                            {{3, A}, {10, B}, {16, TARGET}}};
+} // namespace inl
+#endif
+
+// --- Helpers (the operations of vm::exec, one per opcode) ---
+
+namespace helper {
+using R = Int*;
+using C = const Int*;
+inline void mov(R a, C b, C) noexcept { *a = *b; }
+inline void add(R a, C b, C c) noexcept { *a = *b + *c; }
+inline void sub(R a, C b, C c) noexcept { *a = *b - *c; }
+inline void neg(R a, C b, C) noexcept { *a = -*b; }
+inline void addto(R a, C b, C) noexcept { *a += *b; }
+inline void subfrom(R a, C b, C) noexcept { *a -= *b; }
+inline void print(R a, C, C) noexcept { print_int(*a); }
+inline void mul(R a, C b, C c) noexcept { *a = *b * *c; }
+inline void div(R a, C b, C c) noexcept { *a = ediv(*b, *c); }
+inline void mod(R a, C b, C c) noexcept { *a = emod(*b, *c); }
+inline void eq(R a, C b, C c) noexcept { *a = Int(*b == *c); }
+inline void ne(R a, C b, C c) noexcept { *a = Int(*b != *c); }
+inline void lt(R a, C b, C c) noexcept { *a = Int(*b < *c); }
+inline void gt(R a, C b, C c) noexcept { *a = Int(*b > *c); }
+inline void le(R a, C b, C c) noexcept { *a = Int(*b <= *c); }
+inline void ge(R a, C b, C c) noexcept { *a = Int(*b >= *c); }
+inline void muladd(R a, C b, C c) noexcept { mul_add(*a, '+', *b, *c); }
+inline void mulsub(R a, C b, C c) noexcept { mul_add(*a, '-', *b, *c); }
+inline void sum(R a, const uint32_t* run, R r) noexcept { vm::sum(*a, run, r); }
+inline void move(R a, R b, C) noexcept { move_int(*a, *b); }
+inline bool par(R, const vm::Reduce* red, R r) noexcept { return vm::reduce(*red, r); }
+inline bool jz(C a, C, C) noexcept { return *a == 0; }
+inline bool jeq(C a, C b, C) noexcept { return *a == *b; }
+inline bool jne(C a, C b, C) noexcept { return !(*a == *b); }
+inline bool jneg(C a, C, C) noexcept { return *a < 0; }
+} // namespace helper
+
+// Stencil and helper for one instruction
+inline std::pair<const Stencil*, const void*> select(vm::Op op) {
+    using vm::Op;
+    auto fn = [](auto* h) { return reinterpret_cast<const void*>(h); };
+#if INT_BITS == 64
+    switch (op) {
+        case Op::MOV: case Op::MOVE: return {&inl::mov, nullptr};
+        case Op::ADD: return {&inl::add, nullptr};
+        case Op::SUB: return {&inl::sub, nullptr};
+        case Op::NEG: return {&inl::neg, nullptr};
+        case Op::ADDTO: return {&inl::addto, nullptr};
+        case Op::SUBFROM: return {&inl::subfrom, nullptr};
+        case Op::JZ: return {&inl::jz, nullptr};
+        case Op::JEQ: return {&inl::jeq, nullptr};
+        case Op::JNE: return {&inl::jne, nullptr};
+        case Op::JNEG: return {&inl::jneg, nullptr};
+        default: break;
+    }
+#endif
+    switch (op) {
+        case Op::MOV: return {&call, fn(&helper::mov)};
+        case Op::ADD: return {&call, fn(&helper::add)};
+        case Op::SUB: return {&call, fn(&helper::sub)};
+        case Op::NEG: return {&call, fn(&helper::neg)};
+        case Op::ADDTO: return {&call, fn(&helper::addto)};
+        case Op::SUBFROM: return {&call, fn(&helper::subfrom)};
+        case Op::JZ: return {&branch, fn(&helper::jz)};
+        case Op::JEQ: return {&branch, fn(&helper::jeq)};
+        case Op::JMP: return {&jmp, nullptr};
+        case Op::PRINT: return {&call, fn(&helper::print)};
+        case Op::HALT: return {&halt, nullptr};
+        case Op::BRKERR: return {&brkerr, nullptr};
+        case Op::MUL: return {&call, fn(&helper::mul)};
+        case Op::DIV: return {&call, fn(&helper::div)};
+        case Op::MOD: return {&call, fn(&helper::mod)};
+        case Op::EQ: return {&call, fn(&helper::eq)};
+        case Op::NE: return {&call, fn(&helper::ne)};
+        case Op::LT: return {&call, fn(&helper::lt)};
+        case Op::GT: return {&call, fn(&helper::gt)};
+        case Op::LE: return {&call, fn(&helper::le)};
+        case Op::GE: return {&call, fn(&helper::ge)};
+        case Op::JNE: return {&branch, fn(&helper::jne)};
+        case Op::JNEG: return {&branch, fn(&helper::jneg)};
+        case Op::MULADD: return {&call, fn(&helper::muladd)};
+        case Op::SUM: return {&call_run, fn(&helper::sum)};
+        case Op::MOVE: return {&call, fn(&helper::move)};
+        case Op::PAR: return {&branch_red, fn(&helper::par)};
+        default: return {&call, fn(&helper::mulsub)};
+    }
+}
+
+// --- Code ---
+
+// Translated program: executable copy of the stencils, and the native offset
+// of every bytecode instruction. SUM and PAR instructions point into the
+// program's operand runs and reductions, so the vm::Program must outlive its
+// Code.
+class Code {
+    uint8_t* mem_ = nullptr;
+    size_t size_ = 0;
+    std::vector<uint32_t> at_;
+
+public:
+    Code() = default;
+    Code(const Code&) = delete;
+    Code& operator=(const Code&) = delete;
+    ~Code() {
+#if defined(__x86_64__) && defined(__linux__)
+        if (mem_) munmap(mem_, size_);
+#endif
+    }
+
+    friend std::expected<std::unique_ptr<Code>, std::string> translate(const vm::Program& p);
+
+    // Runs from bytecode pc on the VM's registers; false as for vm::run
+    bool run(std::vector<Int>& regs, uint32_t pc = 0) const {
+        auto entry = reinterpret_cast<bool (*)(Int*, const void*)>(mem_);
+        return entry(regs.data(), mem_ + at_[pc]);
+    }
+};
+
+inline std::expected<std::unique_ptr<Code>, std::string> translate(const vm::Program& p) {
+#if defined(__x86_64__) && defined(__linux__)
+    // Pass 1: instruction offsets
+    std::vector<std::pair<const Stencil*, const void*>> sel;
+    sel.reserve(p.code.size());
+    auto code = std::make_unique<Code>();
+    uint32_t size = uint32_t(prologue.code.size());
+    for (auto& in : p.code) {
+        sel.push_back(select(in.op));
+        code->at_.push_back(size);
+        size += uint32_t(sel.back().first->code.size());
+    }
+
+    // Pass 2: copy and patch
+    void* mem = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) return std::unexpected(std::format("mmap: {}", std::strerror(errno)));
+    code->mem_ = static_cast<uint8_t*>(mem);
+    code->size_ = size;
+    auto* out = code->mem_;
+    std::ranges::copy(prologue.code, out);
+    for (size_t i = 0; i < p.code.size(); ++i) {
+        auto& in = p.code[i];
+        auto [st, fn] = sel[i];
+        auto* dst = out + code->at_[i];
+        std::ranges::copy(st->code, dst);
+        for (auto [off, kind] : st->holes) {
+            auto* h = dst + off;
+            auto disp = [](uint32_t reg) { return int32_t(reg * sizeof(Int)); };
+            switch (kind) {
+                case A: { int32_t d = disp(in.a); std::memcpy(h, &d, 4); break; }
+                case B: { int32_t d = disp(in.b); std::memcpy(h, &d, 4); break; }
+                case C: { int32_t d = disp(in.c); std::memcpy(h, &d, 4); break; }
+                case FN: std::memcpy(h, &fn, 8); break;
+                case RUN: { const uint32_t* run = p.terms.data() + in.b; std::memcpy(h, &run, 8); break; }
+                case RED: { const vm::Reduce* red = &p.reduces[in.b]; std::memcpy(h, &red, 8); break; }
+                case TARGET: {
+                    auto rel = int32_t(int64_t(code->at_[in.c]) - int64_t(h + 4 - out));
+                    std::memcpy(h, &rel, 4);
+                    break;
+                }
+            }
+        }
+    }
+    if (mprotect(mem, size, PROT_READ | PROT_EXEC) != 0)
+        return std::unexpected(std::format("mprotect: {}", std::strerror(errno)));
+    return code;
+#else
+    (void)p;
+    return std::unexpected(std::string("the baseline JIT needs x86-64 Linux"));
+#endif
+}
+
+} // namespace baseline
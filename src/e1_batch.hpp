@@ -0,0 +1,155 @@
+// PL/0 Levels 1-2 — Batch execution (e1 --batch inputs.csv [--jobs N])
+//
+// Runs one program over a table of arguments in one process. The program is
+// compiled once (e1_compile_with, libe1.h) and shared by a pool of worker
+// threads; each worker runs it in its own e1_context (register file and
+// closures, kept from row to row) and collects the row's output in its own
+// buffer through the output callback. The main thread writes the rows out in
+// input order, every line tagged with the 1-based row number:
+//   inputs.csv    output
+//   arg1,arg2
+//   1,5           1,120
+//   1,10          2,3628800
+// A row is arg1,arg2,..., at most ARG_COUNT values; missing ones are 0.
+// Blank lines and a first line that starts with a letter (a header) are
+// skipped, and whitespace around values is ignored. Every value is checked
+// before anything runs.
+//
+// Scheduling is work stealing over row ranges: worker w starts with the w-th
+// contiguous share of the rows and claims them from the front, one at a
+// time under the share's lock (uncontended unless a thief is there); a
+// worker whose share is empty steals the back half of the next non-empty
+// share.
+#pragma once
+#include "libe1.h"
+#include "e1.hpp"
+#include <atomic>
+#include <cctype>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+namespace batch {
+
+struct Table {
+    std::vector<char> text;   // the file, with separators replaced by NULs (a vector:
+                              // cells point into it, and moving must not move it)
+    std::vector<char*> cells;  // per row: ARG_COUNT values (nullptr if missing), then nullptr
+    size_t rows() const { return cells.size() / (ARG_COUNT + 1); }
+    const char* const* row(size_t i) const { return cells.data() + i * (ARG_COUNT + 1); }
+};
+
+inline bool is_space(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+// Reads and checks the argument table
+inline std::expected<Table, std::string> read_csv(const char* path) {
+    auto src = read_file(path);
+    if (!src) return std::unexpected(src.error());
+    Table t{{src->text().begin(), src->text().end()}, {}};
+    t.text.push_back('\0');
+    char* p = t.text.data();
+    char* end = p + t.text.size() - 1;
+    for (int line = 1; p < end; ++line) {
+        char* eol = std::find(p, end, '\n');
+        *eol = '\0';  // at end: the string's terminator
+        char* q = p;
+        while (q < eol && is_space(*q)) ++q;
+        bool header = line == 1 && std::isalpha(static_cast<unsigned char>(*q));
+        if (q < eol && !header) {
+            size_t row = t.cells.size();
+            for (int col = 0;; ++col) {
+                char* sep = std::find(q, eol, ',');
+                *sep = '\0';
+                while (q < sep && is_space(*q)) ++q;
+                char* e = sep;
+                while (e > q && is_space(e[-1])) *--e = '\0';
+                if (col == ARG_COUNT)
+                    return std::unexpected(std::format("{}:{}: more than {} values", path, line, ARG_COUNT));
+                if (bigint::bad_digit(q))
+                    return std::unexpected(std::format("{}:{}: invalid integer argument '{}'", path, line, q));
+                t.cells.push_back(q);
+                if (sep == eol) break;
+                q = sep + 1;
+            }
+            t.cells.resize(row + ARG_COUNT + 1, nullptr);
+        }
+        p = eol + 1;
+    }
+    return t;
+}
+
+// A worker's share of the rows, [next, end)
+struct alignas(64) Share {
+    std::mutex m;
+    size_t next = 0, end = 0;
+};
+
+// Runs prog over every row of `t` on `jobs` threads. A row whose break
+// escapes every loop is reported on stderr ("row,message"); the result is 1
+// if a row failed, else 0.
+inline int run(const Table& t, unsigned jobs, const e1_program* prog) {
+    size_t n = t.rows();
+    jobs = unsigned(std::clamp<size_t>(jobs, 1, std::max<size_t>(n, 1)));
+    std::vector<Share> shares(jobs);
+    for (unsigned w = 0; w < jobs; ++w) {
+        shares[w].next = n * w / jobs;
+        shares[w].end = n * (w + 1) / jobs;
+    }
+    std::vector<std::string> results(n);
+    std::vector<std::atomic<bool>> done(n);
+    std::atomic<int> status = 0;
+
+    auto claim = [&](unsigned w) -> std::optional<size_t> {
+        {
+            std::lock_guard lock(shares[w].m);
+            if (shares[w].next < shares[w].end) return shares[w].next++;
+        }
+        for (unsigned i = 1; i < jobs; ++i) {
+            auto& v = shares[(w + i) % jobs];
+            size_t lo, hi;
+            {
+                std::lock_guard lock(v.m);
+                if (v.next == v.end) continue;
+                lo = v.next + (v.end - v.next) / 2;
+                hi = std::exchange(v.end, lo);
+            }
+            std::lock_guard lock(shares[w].m);
+            shares[w].next = lo + 1;
+            shares[w].end = hi;
+            return lo;
+        }
+        return std::nullopt;
+    };
+    auto work = [&](unsigned w) {
+        std::unique_ptr<e1_context, decltype(&e1_context_free)> ctx(e1_context_new(), e1_context_free);
+        std::string buf;
+        auto collect = [](void* user, const char* data, size_t len) { static_cast<std::string*>(user)->append(data, len); };
+        while (auto i = claim(w)) {
+            buf.clear();
+            int st = e1_run_in(ctx.get(), prog, t.row(*i), collect, &buf);
+            if (st == E1_BREAK_OUTSIDE_LOOP) std::println(stderr, "{},{}", *i + 1, e1_status_message(st));
+            if (st == E1_FAILED) status = 1;
+            auto& r = results[*i];
+            auto tag = std::format("{},", *i + 1);
+            for (size_t at = 0; at < buf.size();) {
+                size_t eol = buf.find('\n', at);
+                eol = eol == std::string::npos ? buf.size() : eol + 1;
+                r.append(tag).append(buf, at, eol - at);
+                at = eol;
+            }
+            done[*i].store(true, std::memory_order_release);
+            done[*i].notify_one();
+        }
+    };
+
+    std::vector<std::jthread> pool;
+    for (unsigned w = 0; w < jobs; ++w) pool.emplace_back(work, w);
+    for (size_t i = 0; i < n; ++i) {
+        done[i].wait(false, std::memory_order_acquire);
+        out::write(results[i].data(), results[i].size());
+        std::string().swap(results[i]);
+    }
+    return status;
+}
+
+} // namespace batch
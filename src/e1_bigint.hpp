@@ -1,12 +1,16 @@
 // Header-only bigint implementation
 // Used directly by C++ backend, compiled to .o for LLVM backend
 #pragma once
+#include <compare>
+#include <cstddef>
 #include <cstdint>
 #include <cstdlib>
 #include <cstdio>
 #include <cstring>
 #include <string>
+#include <utility>
 #include <print>
+#include "e1_out.hpp"
 
 namespace bigint {
 
@@ -61,6 +65,60 @@ using Size = uint32_t;
     }
 }
 
+// --- Equal-length carry chains ---
+// r[0..n) = a[0..n) ± b[0..n), returning the carry (borrow) out; r may alias
+// a or b. On x86-64 with 64-bit limbs the bulk runs four limbs per iteration
+// in one adc (sbb) chain kept in the carry flag across iterations (lea and
+// dec leave it alone), which the builtins in a C++ loop cannot express. The
+// chain needs nothing beyond baseline x86-64, so there is nothing to
+// dispatch on at run time; E1_GENERIC_KERNELS keeps the portable loop (the
+// LLVM runtime, e1_rt_bigint.cpp, is IR for any target).
+#if defined(__x86_64__) && LIMB_BITS == 64 && !defined(E1_GENERIC_KERNELS)
+#define E1_ADC_CHAIN 1
+#define E1_CHAIN4(op)                                                               \
+    "movq (%[a]), %%r8\n\t" "movq 8(%[a]), %%r9\n\t"                              \
+    "movq 16(%[a]), %%r10\n\t" "movq 24(%[a]), %%r11\n\t"                         \
+    op " (%[b]), %%r8\n\t" op " 8(%[b]), %%r9\n\t"                                \
+    op " 16(%[b]), %%r10\n\t" op " 24(%[b]), %%r11\n\t"                           \
+    "movq %%r8, (%[r])\n\t" "movq %%r9, 8(%[r])\n\t"                              \
+    "movq %%r10, 16(%[r])\n\t" "movq %%r11, 24(%[r])\n\t"                         \
+    "leaq 32(%[a]), %[a]\n\t" "leaq 32(%[b]), %[b]\n\t" "leaq 32(%[r]), %[r]\n\t"
+#endif
+
+[[gnu::hot]] inline Limb add_nn(Limb* r, const Limb* a, const Limb* b, Size n) {
+    Limb carry = 0;
+    Size i = 0;
+#ifdef E1_ADC_CHAIN
+    if (uint64_t blocks = n / 4) {
+        auto *ra = r, *aa = const_cast<Limb*>(a), *ba = const_cast<Limb*>(b);
+        asm("clc\n1:\n\t" E1_CHAIN4("adcq") "decq %[k]\n\t" "jnz 1b\n\t" "adcq $0, %[c]"
+            : [r] "+r"(ra), [a] "+r"(aa), [b] "+r"(ba), [k] "+r"(blocks), [c] "+r"(carry)
+            :
+            : "r8", "r9", "r10", "r11", "cc", "memory");
+        i = n & ~Size(3);
+    }
+#endif
+    for (; i < n; i++) r[i] = addc(a[i], b[i], carry, &carry);
+    return carry;
+}
+
+[[gnu::hot]] inline Limb sub_nn(Limb* r, const Limb* a, const Limb* b, Size n) {
+    Limb borrow = 0;
+    Size i = 0;
+#ifdef E1_ADC_CHAIN
+    if (uint64_t blocks = n / 4) {
+        auto *ra = r, *aa = const_cast<Limb*>(a), *ba = const_cast<Limb*>(b);
+        asm("clc\n1:\n\t" E1_CHAIN4("sbbq") "decq %[k]\n\t" "jnz 1b\n\t" "adcq $0, %[c]"
+            : [r] "+r"(ra), [a] "+r"(aa), [b] "+r"(ba), [k] "+r"(blocks), [c] "+r"(borrow)
+            :
+            : "r8", "r9", "r10", "r11", "cc", "memory");
+        i = n & ~Size(3);
+    }
+#endif
+    for (; i < n; i++) r[i] = subc(a[i], b[i], borrow, &borrow);
+    return borrow;
+}
+
 struct Raw {
     Size size;
     bool neg;
@@ -69,9 +127,10 @@ struct Raw {
     static constexpr Size buf_size(Size n) { return sizeof(Raw) + n * sizeof(Limb); }
 };
 
-// --- Stack allocation macros for C++ backend ---
+// --- Stack temporaries ---
 // BIGINT_TMP(name, limbs) - declare stack-allocated Raw& with given limb capacity
 // BIGINT_LIT(name)        - declare stack-allocated Raw& for a literal (1 limb)
+// (compiled programs take their temporaries from an Arena, see below)
 #define BIGINT_TMP(name, limbs) \
     alignas(8) char name##_buf[bigint::Raw::buf_size(limbs)]; \
     auto& name = *reinterpret_cast<bigint::Raw*>(name##_buf)
@@ -98,27 +157,52 @@ inline void copy(Raw& __restrict dst, const Raw& __restrict src) {
     return 0;
 }
 
+// Number of limbs below and including the highest one where a and b differ
+// (0: equal). Operands of equal length usually differ in the top limb.
+[[nodiscard]] inline Size diff_len(const Limb* a, const Limb* b, Size n) {
+    while (n > 0 && a[n-1] == b[n-1]) n--;
+    return n;
+}
+
+// |a| + |b|; the kernels take the operands longest first
 [[gnu::hot]] inline void add_mag(Raw* __restrict out, const Raw* __restrict a, const Raw* __restrict b) {
-    auto n = std::max(a->size, b->size);
-    Limb carry = 0;
-    for (Size i = 0; i < n; i++) {
-        auto av = i < a->size ? a->limbs[i] : Limb0;
-        auto bv = i < b->size ? b->limbs[i] : Limb0;
-        out->limbs[i] = addc(av, bv, carry, &carry);
-    }
+    if (a->size < b->size) std::swap(a, b);
+    Size n = a->size, i = b->size;
+    Limb carry = add_nn(out->limbs, a->limbs, b->limbs, i);
+    for (; carry && i < n; i++) carry = (out->limbs[i] = a->limbs[i] + 1) == 0;
+    std::memcpy(out->limbs + i, a->limbs + i, (n - i) * sizeof(Limb));
     out->size = carry ? (out->limbs[n] = carry, n + 1) : n;
 }
 
+// |a| - |b| for |a| >= |b|
 [[gnu::hot]] inline void sub_mag(Raw* __restrict out, const Raw* __restrict a, const Raw* __restrict b) {
-    auto n = a->size;
-    Limb borrow = 0;
-    for (Size i = 0; i < n; i++) {
-        auto av = a->limbs[i];
-        auto bv = i < b->size ? b->limbs[i] : Limb0;
-        out->limbs[i] = subc(av, bv, borrow, &borrow);
+    Size n = a->size, i = b->size;
+    Limb borrow = sub_nn(out->limbs, a->limbs, b->limbs, i);
+    for (; borrow && i < n; i++) borrow = (out->limbs[i] = a->limbs[i] - 1) == ~Limb0;
+    std::memcpy(out->limbs + i, a->limbs + i, (n - i) * sizeof(Limb));
+    while (n > 0 && out->limbs[n-1] == 0) n--;
+    out->size = n;
+}
+
+// ||a| - |b|| in one pass, without comparing the magnitudes first: the
+// longer operand is the larger, and operands of equal length are ordered by
+// their highest differing limb, above which the difference is zero anyway.
+// Returns whether |a| < |b|.
+[[gnu::hot]] inline bool diff_mag(Raw* __restrict out, const Raw* __restrict a, const Raw* __restrict b) {
+    if (a->size != b->size) {
+        bool less = a->size < b->size;
+        if (less) sub_mag(out, b, a);
+        else sub_mag(out, a, b);
+        return less;
     }
+    Size n = diff_len(a->limbs, b->limbs, a->size);
+    if (n == 0) { out->size = 0; return false; }
+    bool less = a->limbs[n-1] < b->limbs[n-1];
+    if (less) std::swap(a, b);
+    sub_nn(out->limbs, a->limbs, b->limbs, n);
     while (n > 0 && out->limbs[n-1] == 0) n--;
     out->size = n;
+    return less;
 }
 
 [[nodiscard]] inline Size add_size(const Raw& __restrict a, const Raw& __restrict b) { return std::max(a.size, b.size) + 1; }
@@ -127,15 +211,13 @@ inline void copy(Raw& __restrict dst, const Raw& __restrict src) {
 // Public API uses references; internally calls pointer-based *_mag for __restrict optimization
 inline void add(Raw& __restrict out, const Raw& __restrict a, const Raw& __restrict b) {
     if (a.neg == b.neg) { add_mag(&out, &a, &b); out.neg = a.neg; }
-    else if (cmp_mag(a, b) >= 0) { sub_mag(&out, &a, &b); out.neg = a.neg; }
-    else { sub_mag(&out, &b, &a); out.neg = b.neg; }
+    else out.neg = diff_mag(&out, &a, &b) ? b.neg : a.neg;
     if (out.size == 0) out.neg = false;
 }
 
 inline void sub(Raw& __restrict out, const Raw& __restrict a, const Raw& __restrict b) {
     if (a.neg != b.neg) { add_mag(&out, &a, &b); out.neg = a.neg; }
-    else if (cmp_mag(a, b) >= 0) { sub_mag(&out, &a, &b); out.neg = a.neg; }
-    else { sub_mag(&out, &b, &a); out.neg = !a.neg; }
+    else out.neg = diff_mag(&out, &a, &b) ? !a.neg : a.neg;
     if (out.size == 0) out.neg = false;
 }
 
@@ -145,62 +227,633 @@ inline void neg(Raw& __restrict out, const Raw& __restrict a) {
 }
 
 [[nodiscard]] inline bool is_zero(const Raw& __restrict a) { return a.size == 0; }
+[[nodiscard]] inline bool is_neg(const Raw& __restrict a) { return a.neg && a.size != 0; }
 
-// Multiply limb by 10, add carry, return new carry (high part)
-inline Limb mul10_add(Limb a, Limb carry_in, Limb* lo) {
-    // a * 10 = a * 8 + a * 2
-    Limb a8, a2, sum;
-    Limb c1 = a >> (LimbBits - 3);  // high 3 bits of a*8
-    a8 = a << 3;
-    Limb c2 = a >> (LimbBits - 1);  // high bit of a*2
-    a2 = a << 1;
-    Limb c3 = __builtin_add_overflow(a8, a2, &sum);
-    Limb c4 = __builtin_add_overflow(sum, carry_in, lo);
-    return c1 + c2 + c3 + c4;
+// Compare with a single-limb literal without materializing it
+[[nodiscard]] inline bool eq_si(const Raw& __restrict a, SLimb v) {
+    if (v == 0) return a.size == 0;
+    auto mag = v < 0 ? Limb0 - static_cast<Limb>(v) : static_cast<Limb>(v);
+    return a.size == 1 && a.neg == (v < 0) && a.limbs[0] == mag;
 }
 
-[[gnu::cold]] inline void from_str(Raw& __restrict out, const char* __restrict s) {
-    out.size = 0;
-    out.neg = (*s == '-') ? (s++, true) : (*s == '+' ? (s++, false) : false);
-    while (*s) {
-        Limb carry = *s++ - '0';
-        for (Size i = 0; i < out.size; i++) {
-            carry = mul10_add(out.limbs[i], carry, &out.limbs[i]);
+// Single-limb fast path for add (bneg = b.neg) and sub (bneg = !b.neg):
+// out = a + (bneg ? -|b| : |b|). `out` needs one limb and may alias a or b.
+// Returns false, leaving out untouched, if an operand has more than one limb
+// or the magnitude carries into a second limb.
+[[gnu::hot]] inline bool add1(Raw& out, const Raw& a, const Raw& b, bool bneg) {
+    if (a.size > 1 || b.size > 1) return false;
+    Limb x = a.size ? a.limbs[0] : Limb0, y = b.size ? b.limbs[0] : Limb0, m;
+    bool n;
+    if (a.neg == bneg) {
+        Limb c;
+        m = addc(x, y, 0, &c);
+        if (c) return false;
+        n = a.neg;
+    } else if (x >= y) { m = x - y; n = a.neg; }
+    else { m = y - x; n = bneg; }
+    out.limbs[0] = m;
+    out.size = m != 0;
+    out.neg = n && m != 0;
+    return true;
+}
+
+// --- N-ary sum ---
+// A chain of additions and subtractions (a + b - c + d) in one pass over the
+// limbs instead of one pass and one temporary per operator: each output limb
+// is the signed sum of the operands' limbs plus the carry, accumulated in a
+// double-width signed limb (the carry stays within ±k for k operands). A
+// negative total leaves its two's complement in the limbs, which a second
+// pass over the output negates.
+
+using SDLimb = signed _BitInt(LIMB_BITS * 2);
+
+// One operand of sum(): +v, or -v if sub
+struct Term { const Raw* v; bool sub; };
+
+// k operands below 2^(LimbBits-2) need one limb more than the longest
+[[nodiscard]] inline Size sum_size(const Term* t, Size k) {
+    Size n = 0;
+    for (Size i = 0; i < k; i++) n = std::max(n, t[i].v->size);
+    return n + 1;
+}
+
+// out = Σ ±t[i].v. out needs sum_size(t, k) limbs; it may be one of the
+// operands (the whole Raw, not an overlapping part).
+[[gnu::hot]] inline void sum(Raw& out, const Term* t, Size k) {
+    // Nonzero operands split by effective sign, each group longest first, so
+    // the operands still in play at limb j are a prefix of their group
+    const Limb* pl[k]; const Limb* nl[k];
+    Size ps[k], ns[k], np = 0, nn = 0, n = 0;
+    for (Size i = 0; i < k; i++) {
+        const Raw& v = *t[i].v;
+        if (v.size == 0) continue;
+        n = std::max(n, v.size);
+        bool minus = v.neg != t[i].sub;
+        auto* l = minus ? nl : pl;
+        auto* sz = minus ? ns : ps;
+        Size& m = minus ? nn : np;
+        Size at = m++;
+        for (; at > 0 && sz[at-1] < v.size; at--) l[at] = l[at-1], sz[at] = sz[at-1];
+        l[at] = v.limbs, sz[at] = v.size;
+    }
+    SDLimb acc = 0;
+    for (Size j = 0; j < n; j++) {
+        while (np > 0 && ps[np-1] <= j) np--;
+        while (nn > 0 && ns[nn-1] <= j) nn--;
+        for (Size i = 0; i < np; i++) acc += pl[i][j];
+        for (Size i = 0; i < nn; i++) acc -= nl[i][j];
+        out.limbs[j] = static_cast<Limb>(acc);
+        acc >>= LimbBits;
+    }
+    // acc is the top limb, in [-k, k]
+    bool neg = acc < 0;
+    if (neg) {  // -(acc·β^n + low) = (-acc - borrow)·β^n + (0 - low)
+        Limb borrow = 0;
+        for (Size j = 0; j < n; j++) out.limbs[j] = subc(Limb0, out.limbs[j], borrow, &borrow);
+        acc = -acc - borrow;
+    }
+    out.limbs[n] = static_cast<Limb>(acc);
+    n++;
+    while (n > 0 && out.limbs[n-1] == 0) n--;
+    out.size = n;
+    out.neg = neg && n != 0;
+}
+
+// --- Decimal output ---
+// Digits are produced DecDigits at a time by dividing by DecBase, the largest
+// power of ten that fits in a limb (10^19 for 64-bit limbs), so a value of n
+// limbs takes about n·(LimbBits/DecDigits/3.3) single-limb division passes
+// instead of one pass per digit. Values longer than DecSplit limbs are first
+// split in half by divide-and-conquer: v = q·10^k + r with 10^k = DecBase^(2^j)
+// taken from a power table that is built once and kept, and each half is
+// converted recursively into its own slice of the output. The split uses
+// Karatsuba multiplication and Burnikel-Ziegler division, so large values
+// convert in subquadratic time.
+
+inline constexpr int DecDigits = [] {
+    int d = 0;
+    for (Limb p = 1; p <= static_cast<Limb>(~Limb0) / 10; p *= 10) d++;
+    return d;
+}();
+inline constexpr Limb DecBase = [] {
+    Limb p = 1;
+    for (int i = 0; i < DecDigits; i++) p *= 10;
+    return p;
+}();
+inline constexpr Size DecSplit = 48;  // limbs; below this the chunked loop wins
+
+// Upper bound on the decimal digits of an n-limb magnitude
+// (~0.302 decimal digits per bit, log10(2), rounded up to 0.31)
+[[nodiscard]] inline constexpr size_t dec_len(Size n) { return (size_t(n) * LimbBits * 31 + 99) / 100 + 1; }
+
+[[nodiscard]] inline Size trim(const Limb* a, Size n) {
+    while (n > 0 && a[n - 1] == 0) n--;
+    return n;
+}
+
+// q[0..n) = a[0..n) / d, returns a % d. q may alias a.
+inline Limb divrem_1(Limb* q, const Limb* a, Size n, Limb d) {
+    Limb rem = 0;
+    for (Size i = n; i-- > 0; ) {
+        auto cur = (static_cast<DLimb>(rem) << LimbBits) | a[i];
+        q[i] = static_cast<Limb>(cur / d);
+        rem = static_cast<Limb>(cur % d);
+    }
+    return rem;
+}
+
+// r[0..rn) += b[0..bn) for bn <= rn; returns the carry out of the top limb
+inline Limb add_n(Limb* r, Size rn, const Limb* b, Size bn) {
+    Limb carry = add_nn(r, r, b, bn);
+    for (Size i = bn; carry && i < rn; i++) carry = ++r[i] == 0;
+    return carry;
+}
+
+// r[0..rn) -= b[0..bn) for bn <= rn; returns the borrow out of the top limb
+inline Limb sub_n(Limb* r, Size rn, const Limb* b, Size bn) {
+    Limb borrow = sub_nn(r, r, b, bn);
+    for (Size i = bn; borrow && i < rn; i++) borrow = r[i]-- == 0;
+    return borrow;
+}
+
+[[nodiscard]] inline int cmp_n(const Limb* a, const Limb* b, Size n) {
+    for (Size i = n; i-- > 0; )
+        if (a[i] != b[i]) return a[i] > b[i] ? 1 : -1;
+    return 0;
+}
+
+inline Limb* alloc_limbs(size_t n) { return static_cast<Limb*>(std::malloc(n * sizeof(Limb))); }
+
+// --- Multiplication ---
+inline constexpr Size KaratsubaMin = 32;  // limbs; below this schoolbook wins
+
+// Schoolbook product: out[0..n+m) = a[0..n) · b[0..m). out must not alias a or b.
+inline void mul_basecase(Limb* __restrict out, const Limb* a, Size n, const Limb* b, Size m) {
+    std::memset(out, 0, (size_t(n) + m) * sizeof(Limb));
+    for (Size i = 0; i < n; i++) {
+        Limb carry = 0;
+        for (Size j = 0; j < m; j++) {
+            auto t = static_cast<DLimb>(a[i]) * b[j] + out[i + j] + carry;
+            out[i + j] = static_cast<Limb>(t);
+            carry = static_cast<Limb>(t >> LimbBits);
         }
-        if (carry) out.limbs[out.size++] = carry;
+        out[i + m] = carry;
     }
-    if (out.size == 0) out.neg = false;
 }
 
-// Divide (rem:limb) by 10, return quotient and update rem
-inline Limb div10(Limb hi, Limb lo, Limb* __restrict rem_out) {
-    // Use 128-bit division - no portable builtin alternative
-    auto cur = (static_cast<DLimb>(hi) << LimbBits) | lo;
-    *rem_out = cur % 10;
-    return static_cast<Limb>(cur / 10);
+// out[0..n+m) = a[0..n) · b[0..m), Karatsuba above KaratsubaMin limbs.
+// out must not alias a or b.
+inline void mul_mag(Limb* __restrict out, const Limb* a, Size n, const Limb* b, Size m) {
+    if (n < m) std::swap(a, b), std::swap(n, m);
+    if (m < KaratsubaMin) return mul_basecase(out, a, n, b, m);
+    Size h = (n + 1) / 2;
+    if (m <= h) {
+        // Unbalanced: a·b = a0·b + a1·b·β^h
+        auto* t = alloc_limbs(size_t(n - h) + m);
+        mul_mag(out, a, h, b, m);
+        mul_mag(t, a + h, n - h, b, m);
+        std::memset(out + h + m, 0, (n - h) * sizeof(Limb));
+        add_n(out + h, n + m - h, t, n - h + m);
+        std::free(t);
+        return;
+    }
+    // a = a1·β^h + a0, b = b1·β^h + b0: z0 = a0·b0 and z2 = a1·b1 go straight
+    // into out, z1 = (a0 + a1)(b0 + b1) - z0 - z2 is added in at β^h
+    mul_mag(out, a, h, b, h);
+    mul_mag(out + 2 * h, a + h, n - h, b + h, m - h);
+    auto* sa = alloc_limbs(4 * (size_t(h) + 1));
+    auto* sb = sa + h + 1;
+    auto* z1 = sb + h + 1;
+    std::memcpy(sa, a, h * sizeof(Limb));
+    sa[h] = add_n(sa, h, a + h, n - h);
+    std::memcpy(sb, b, h * sizeof(Limb));
+    sb[h] = add_n(sb, h, b + h, m - h);
+    mul_mag(z1, sa, h + 1, sb, h + 1);
+    sub_n(z1, 2 * h + 2, out, 2 * h);
+    sub_n(z1, 2 * h + 2, out + 2 * h, n + m - 2 * h);
+    add_n(out + h, n + m - h, z1, trim(z1, 2 * h + 2));
+    std::free(sa);
 }
 
-[[gnu::cold]] inline void print(const Raw& __restrict v) {
-    if (v.size == 0) { puts("0"); return; }
-    auto* tmp = static_cast<Limb*>(std::malloc(v.size * sizeof(Limb)));
-    Size n = v.size;
-    std::memcpy(tmp, v.limbs, n * sizeof(Limb));
-    // ~0.302 decimal digits per bit (log10(2)), round up to 0.31
-    Size buf_cap = (n * LimbBits * 31 + 99) / 100 + 1;
-    auto* buf = static_cast<char*>(std::malloc(buf_cap));
-    Size pos = 0;
+// --- Division ---
+inline constexpr Size BurnikelZieglerMin = 48;  // limbs; below this Algorithm D wins
+
+// Knuth, TAOCP vol. 2, 4.3.1, Algorithm D. For n >= m >= 2 and b[m-1] != 0:
+// q[0..n-m] = a / b and r[0..m) = a % b. Neither output may alias an input.
+inline void divmod_basecase(Limb* __restrict q, Limb* __restrict r, const Limb* a, Size n, const Limb* b, Size m) {
+    // Normalize so the divisor's top bit is set; u gets one extra limb
+    int s = 0;
+    while (!((b[m - 1] << s) >> (LimbBits - 1))) s++;
+    auto* u = static_cast<Limb*>(std::malloc((size_t(n) + 1 + m) * sizeof(Limb)));
+    auto* v = u + n + 1;
+    auto shl = [s](Limb hi, Limb lo) { return s ? (hi << s) | (lo >> (LimbBits - s)) : hi; };
+    for (Size i = m; i-- > 1; ) v[i] = shl(b[i], b[i - 1]);
+    v[0] = b[0] << s;
+    u[n] = s ? a[n - 1] >> (LimbBits - s) : Limb0;
+    for (Size i = n; i-- > 1; ) u[i] = shl(a[i], a[i - 1]);
+    u[0] = a[0] << s;
+
+    const auto base = static_cast<DLimb>(1) << LimbBits;
+    for (Size j = n - m + 1; j-- > 0; ) {
+        // Estimate q̂ from the top two limbs, then correct it (at most twice)
+        auto top = (static_cast<DLimb>(u[j + m]) << LimbBits) | u[j + m - 1];
+        DLimb qhat = top / v[m - 1], rhat = top % v[m - 1];
+        while (qhat >= base || qhat * v[m - 2] > ((rhat << LimbBits) | u[j + m - 2])) {
+            qhat--;
+            rhat += v[m - 1];
+            if (rhat >= base) break;
+        }
+        // u[j..j+m] -= q̂ · v
+        Limb mul_carry = 0, borrow = 0;
+        for (Size i = 0; i < m; i++) {
+            auto p = qhat * v[i] + mul_carry;
+            mul_carry = static_cast<Limb>(p >> LimbBits);
+            u[i + j] = subc(u[i + j], static_cast<Limb>(p), borrow, &borrow);
+        }
+        u[j + m] = subc(u[j + m], mul_carry, borrow, &borrow);
+        if (borrow) {  // q̂ was one too large: add v back
+            qhat--;
+            Limb carry = 0;
+            for (Size i = 0; i < m; i++) u[i + j] = addc(u[i + j], v[i], carry, &carry);
+            u[j + m] += carry;
+        }
+        q[j] = static_cast<Limb>(qhat);
+    }
+    for (Size i = 0; i + 1 < m; i++) r[i] = s ? (u[i] >> s) | (u[i + 1] << (LimbBits - s)) : u[i];
+    r[m - 1] = u[m - 1] >> s;
+    std::free(u);
+}
+
+// Burnikel & Ziegler, "Fast Recursive Division" (1998). The divisor b has k
+// limbs with its top bit set; both recursions need a < b·β^k (resp. a < b·β^h)
+// and leave k (h) quotient limbs in q. Most of the work ends up in mul_mag.
+inline void div2n1n(Limb* q, Limb* r, const Limb* a, const Limb* b, Size k);
+
+// q[0..h) = a[0..3h) / b[0..2h), r[0..2h) = remainder
+inline void div3n2n(Limb* q, Limb* r, const Limb* a, const Limb* b, Size h) {
+    // x = r1·β^h + a[0..h) with r1 the remainder of the top two thirds by b1
+    auto* x = alloc_limbs(4 * size_t(h) + 1);
+    auto* d = x + 2 * h + 1;
+    const Limb* b1 = b + h;
+    if (cmp_n(a + 2 * h, b1, h) < 0) {
+        div2n1n(q, x + h, a + h, b1, h);
+        x[2 * h] = 0;
+    } else {
+        // Top third equals b1: q̂ = β^h - 1, r1 = a[h..2h) + b1
+        for (Size i = 0; i < h; i++) q[i] = ~Limb0;
+        std::memcpy(x + h, a + h, h * sizeof(Limb));
+        x[2 * h] = add_n(x + h, h, b1, h);
+    }
+    std::memcpy(x, a, h * sizeof(Limb));
+    // x -= q̂·b0; while negative, add b back (at most twice)
+    mul_mag(d, q, h, b, h);
+    bool negative = sub_n(x, 2 * h + 1, d, 2 * h);
+    while (negative) {
+        const Limb one = 1;
+        sub_n(q, h, &one, 1);
+        if (add_n(x, 2 * h + 1, b, 2 * h)) negative = false;
+    }
+    std::memcpy(r, x, 2 * size_t(h) * sizeof(Limb));
+    std::free(x);
+}
+
+// q[0..k) = a[0..2k) / b[0..k), r[0..k) = remainder
+inline void div2n1n(Limb* q, Limb* r, const Limb* a, const Limb* b, Size k) {
+    if (k % 2 || k < BurnikelZieglerMin) {
+        auto* qt = alloc_limbs(size_t(k) + 1);  // top quotient limb is zero
+        divmod_basecase(qt, r, a, 2 * k, b, k);
+        std::memcpy(q, qt, k * sizeof(Limb));
+        std::free(qt);
+        return;
+    }
+    Size h = k / 2;
+    auto* t = alloc_limbs(3 * size_t(h));  // [a0, remainder of the top 3h limbs]
+    div3n2n(q + h, t + h, a + h, b, h);
+    std::memcpy(t, a, h * sizeof(Limb));
+    div3n2n(q, r, t, b, h);
+    std::free(t);
+}
+
+// dst[0..n + sh/LimbBits + 1) = src[0..n) << sh
+inline void shl_bits(Limb* dst, const Limb* src, Size n, size_t sh) {
+    Size w = Size(sh / LimbBits);
+    int s = int(sh % LimbBits);
+    std::memset(dst, 0, w * sizeof(Limb));
+    Limb hi = 0;
+    for (Size i = 0; i < n; i++) {
+        dst[w + i] = s ? (src[i] << s) | hi : src[i];
+        hi = s ? src[i] >> (LimbBits - s) : Limb0;
+    }
+    dst[w + n] = hi;
+}
+
+// q[0..n-m] = a / b and r[0..m) = a % b for n >= m >= 1 and b[m-1] != 0.
+// Neither output may alias an input.
+inline void divmod_mag(Limb* __restrict q, Limb* __restrict r, const Limb* a, Size n, const Limb* b, Size m) {
+    if (m == 1) { r[0] = divrem_1(q, a, n, b[0]); return; }
+    if (m < BurnikelZieglerMin || n - m < BurnikelZieglerMin) return divmod_basecase(q, r, a, n, b, m);
+    // Pad the divisor to k = j·2^L limbs with its top bit set (shifting both
+    // operands left, which keeps the quotient), so div2n1n halves evenly
+    // down to the Algorithm D cutoff
+    Size L = 0;
+    while ((m >> L) >= BurnikelZieglerMin) L++;
+    Size k = ((m + (Size(1) << L) - 1) >> L) << L;
+    int s = 0;
+    while (!((b[m - 1] << s) >> (LimbBits - 1))) s++;
+    size_t sh = size_t(k - m) * LimbBits + s;
+    // Shifted dividend as t blocks of k limbs; the top block's top bit is clear,
+    // so it is below the divisor
+    Size an = n + (k - m) + 1;
+    Size t = std::max<Size>((an + k - 1) / k, 2);
+    auto* bs = alloc_limbs(size_t(k) + 1 + size_t(t) * k + size_t(t) * k + k);
+    auto* as = bs + k + 1;
+    auto* qs = as + size_t(t) * k;
+    auto* z = qs + size_t(t - 1) * k;  // 2k limbs: [next block, running remainder]
+    shl_bits(bs, b, m, sh);
+    std::memset(as, 0, size_t(t) * k * sizeof(Limb));
+    shl_bits(as, a, n, sh);
+    std::memcpy(z, as + size_t(t - 2) * k, 2 * size_t(k) * sizeof(Limb));
+    for (Size i = t - 1; i-- > 0; ) {
+        div2n1n(qs + size_t(i) * k, z + k, z, bs, k);
+        if (i > 0) std::memcpy(z, as + size_t(i - 1) * k, k * sizeof(Limb));
+    }
+    std::memcpy(q, qs, (size_t(n) - m + 1) * sizeof(Limb));
+    // Shift the remainder back down
+    Size w = Size(sh / LimbBits);
+    for (Size i = 0; i < m; i++) {
+        Limb lo = z[k + w + i], hi = w + i + 1 < k ? z[k + w + i + 1] : Limb0;
+        r[i] = s ? (lo >> s) | (hi << (LimbBits - s)) : lo;
+    }
+    std::free(bs);
+}
+
+// Growable buffer kept across calls (per thread); constant-initialized, so
+// no static guard. Freed when its thread exits (threads of a program that
+// embeds libe1 come and go); the single-threaded runtime keeps it.
+struct Scratch {
+    void* p = nullptr;
+    size_t cap = 0;
+    template <class T> T* get(size_t n) {
+        if (n * sizeof(T) > cap) {
+            cap = std::max(n * sizeof(T), cap * 2);
+            p = std::realloc(p, cap);
+        }
+        return static_cast<T*>(p);
+    }
+#ifndef E1_SINGLE_THREAD
+    ~Scratch() { std::free(p); }
+#endif
+};
+
+// pow10s.tab[j] = DecBase^(2^j), i.e. 10^(DecDigits·2^j); grown on demand,
+// per thread (freed like Scratch)
+struct Pow10 { Limb* limbs; Size size; };
+struct Pow10Table {
+    Pow10 tab[32] = {};
+    int len = 0;
+#ifndef E1_SINGLE_THREAD
+    ~Pow10Table() { for (int j = 0; j < len; j++) std::free(tab[j].limbs); }
+#endif
+};
+inline E1_THREAD_LOCAL Pow10Table pow10s;
+
+inline const Pow10& pow10(int j) {
+    auto& [tab, len] = pow10s;
+    while (len <= j) {
+        if (len == 0) {
+            auto* p = static_cast<Limb*>(std::malloc(sizeof(Limb)));
+            p[0] = DecBase;
+            tab[len++] = {p, 1};
+            continue;
+        }
+        auto& prev = tab[len - 1];
+        auto* p = static_cast<Limb*>(std::malloc(2 * size_t(prev.size) * sizeof(Limb)));
+        mul_mag(p, prev.limbs, prev.size, prev.limbs, prev.size);
+        tab[len++] = {p, trim(p, 2 * prev.size)};
+    }
+    return tab[j];
+}
+
+// Writes the digits of t[0..n) so they end just before `end` and returns the
+// first digit written. With width != 0 the result is zero-padded to exactly
+// `width` digits (the value must fit). Destroys t.
+inline char* dec_basecase(char* end, Limb* t, Size n, size_t width) {
+    char* p = end;
+    n = trim(t, n);
     while (n > 0) {
-        Limb rem = 0;
-        for (Size i = n; i-- > 0; )
-            tmp[i] = div10(rem, tmp[i], &rem);
-        buf[pos++] = '0' + static_cast<int>(rem);
-        while (n > 0 && tmp[n-1] == 0) n--;
+        Limb chunk = divrem_1(t, t, n, DecBase);
+        n = trim(t, n);
+        // Inner chunks are always DecDigits wide; the leading one stops early
+        for (int i = 0; i < DecDigits && (n > 0 || chunk != 0); i++) {
+            *--p = static_cast<char>('0' + static_cast<int>(chunk % 10));
+            chunk /= 10;
+        }
+    }
+    if (width) while (p > end - width) *--p = '0';
+    return p;
+}
+
+inline char* dec_convert(char* end, Limb* t, Size n, size_t width) {
+    n = trim(t, n);
+    if (n < DecSplit) return dec_basecase(end, t, n, width);
+    // Largest power about half as long as t, so quotient and remainder come
+    // out roughly the same length (the square of an s-limb power has at
+    // least 2s-1 limbs; this avoids building a power that won't be used)
+    int j = 0;
+    while (2 * (2 * pow10(j).size - 1) <= n + 1) j++;
+    auto& d = pow10(j);
+    Size qn = n - d.size + 1;
+    auto* q = static_cast<Limb*>(std::malloc((size_t(qn) + d.size) * sizeof(Limb)));
+    auto* r = q + qn;
+    divmod_mag(q, r, t, n, d.limbs, d.size);
+    size_t low = size_t(DecDigits) << j;
+    dec_convert(end, r, d.size, low);
+    char* p = dec_convert(end - low, q, qn, width > low ? width - low : 0);
+    std::free(q);
+    return p;
+}
+
+// Writes the decimal form of v (sign included, no newline) so it ends just
+// before `end`, and returns its first character. Needs dec_len(v.size) + 1
+// bytes before `end`.
+inline char* format_dec(char* end, const Raw& __restrict v) {
+    if (v.size == 0) { *--end = '0'; return end; }
+    static constinit E1_THREAD_LOCAL Scratch work;
+    auto* t = work.get<Limb>(v.size);
+    std::memcpy(t, v.limbs, v.size * sizeof(Limb));
+    char* p = dec_convert(end, t, v.size, 0);
+    if (v.neg) *--p = '-';
+    return p;
+}
+
+// Writes v and a newline through the shared output buffer (e1_out.hpp)
+[[gnu::cold]] inline void print(const Raw& __restrict v) {
+    static constinit E1_THREAD_LOCAL Scratch text;
+    size_t cap = dec_len(v.size) + 2;
+    auto* buf = text.get<char>(cap);
+    buf[cap - 1] = '\n';
+    char* p = format_dec(buf + cap - 1, v);
+    out::write(p, size_t(buf + cap - p));
+}
+
+// --- Decimal input ---
+// The mirror image of output: DecDigits-digit chunks are folded in with one
+// multiply-add pass each, and strings of StrSplit digits or more are split as
+// hi·10^k + lo with 10^k from the same power table, so long inputs parse in
+// subquadratic time.
+
+inline constexpr size_t StrSplit = size_t(DecSplit) * DecDigits;  // digits; below this the chunked loop wins
+
+// Upper bound on the limbs of a value with `digits` decimal digits
+// (~3.32 bits per decimal digit, log2(10), rounded up to 3.33)
+[[nodiscard]] inline constexpr Size dec_limbs(size_t digits) { return Size((digits * 333 / 100 + 1) / LimbBits + 1); }
+
+// Validates a decimal integer literal, [+-]?[0-9]+. Returns nullptr if s is
+// valid, else the first offending character (the terminating NUL if there
+// are no digits).
+[[nodiscard]] inline const char* bad_digit(const char* s) {
+    if (*s == '-' || *s == '+') s++;
+    if (!*s) return s;
+    for (; *s; s++)
+        if (*s < '0' || *s > '9') return s;
+    return nullptr;
+}
+
+// Reports an invalid integer argument (`at` from bad_digit) and exits
+[[noreturn, gnu::cold]] inline void bad_arg(const char* s, const char* at) {
+    if (*at) std::fprintf(stderr, "Error: invalid integer argument '%s': unexpected '%c'\n", s, *at);
+    else std::fprintf(stderr, "Error: invalid integer argument '%s': expected digits\n", s);
+    std::exit(1);
+}
+
+// a[0..n) = a·m + add, returns the carry out
+inline Limb mul_1_add(Limb* a, Size n, Limb m, Limb add) {
+    for (Size i = 0; i < n; i++) {
+        auto t = static_cast<DLimb>(a[i]) * m + add;
+        a[i] = static_cast<Limb>(t);
+        add = static_cast<Limb>(t >> LimbBits);
+    }
+    return add;
+}
+
+// out = value of the digits s[0..len); returns its limb count. out needs
+// dec_limbs(len) limbs.
+inline Size parse_basecase(Limb* out, const char* s, size_t len) {
+    Size n = 0;
+    size_t i = 0;
+    while (i < len) {
+        // The leading chunk takes the odd digits so the rest are full width
+        size_t end = i + (i == 0 && len % DecDigits ? len % DecDigits : DecDigits);
+        Limb chunk = 0, scale = 1;
+        for (; i < end; i++) chunk = chunk * 10 + Limb(s[i] - '0'), scale *= 10;
+        if (Limb carry = mul_1_add(out, n, scale, chunk)) out[n++] = carry;
+    }
+    return n;
+}
+
+inline Size parse_dec(Limb* out, const char* s, size_t len) {
+    if (len < StrSplit) return parse_basecase(out, s, len);
+    // Low part: DecDigits·2^j digits, the largest such length below len
+    int j = 0;
+    while ((size_t(DecDigits) << (j + 1)) < len) j++;
+    size_t lo_len = size_t(DecDigits) << j, hi_len = len - lo_len;
+    auto& p = pow10(j);
+    auto* hi = alloc_limbs(size_t(dec_limbs(hi_len)) + dec_limbs(lo_len));
+    auto* lo = hi + dec_limbs(hi_len);
+    Size hn = parse_dec(hi, s, hi_len), ln = parse_dec(lo, s + hi_len, lo_len);
+    Size n = ln;
+    if (hn == 0) std::memcpy(out, lo, ln * sizeof(Limb));
+    else {
+        // hi·10^k + lo, with lo < 10^k
+        auto* t = alloc_limbs(size_t(hn) + p.size);
+        mul_mag(t, hi, hn, p.limbs, p.size);
+        add_n(t, hn + p.size, lo, ln);
+        n = trim(t, hn + p.size);
+        std::memcpy(out, t, n * sizeof(Limb));
+        std::free(t);
+    }
+    std::free(hi);
+    return n;
+}
+
+// s must be a valid literal (see bad_digit); out needs dec_limbs(strlen(s)) limbs
+[[gnu::cold]] inline void from_str(Raw& __restrict out, const char* __restrict s) {
+    out.neg = (*s == '-') ? (s++, true) : (*s == '+' ? (s++, false) : false);
+    out.size = parse_dec(out.limbs, s, std::strlen(s));
+    if (out.size == 0) out.neg = false;
+}
+
+// --- Multiplication, division and comparison (e2) ---
+// Signed wrappers over the magnitude kernels above (mul_mag: schoolbook,
+// Karatsuba from KaratsubaMin limbs; divmod_mag: Algorithm D, Burnikel-Ziegler
+// from BurnikelZieglerMin limbs). Division is Euclidean, 0 <= a % b < |b|, and
+// x / 0 = x % 0 = 0, the e2 semantics.
+
+[[nodiscard]] inline Size mul_size(const Raw& __restrict a, const Raw& __restrict b) { return a.size + b.size; }
+[[nodiscard]] inline Size div_size(const Raw& __restrict a, const Raw&) { return a.size + 1; }
+[[nodiscard]] inline Size mod_size(const Raw&, const Raw& __restrict b) { return b.size; }
+
+// out may not alias a or b; a and b may alias each other
+inline void mul(Raw& __restrict out, const Raw& a, const Raw& b) {
+    if (a.size == 0 || b.size == 0) { out.size = 0; out.neg = false; return; }
+    mul_mag(out.limbs, a.limbs, a.size, b.limbs, b.size);
+    out.size = trim(out.limbs, a.size + b.size);
+    out.neg = a.neg != b.neg;
+}
+
+// *q = a / b and *r = a % b; either may be null. Neither may alias a or b.
+inline void divmod(Raw* __restrict q, Raw* __restrict r, const Raw& a, const Raw& b) {
+    Size n = a.size, m = b.size;
+    if (n == 0 || m == 0) {
+        if (q) q->size = 0, q->neg = false;
+        if (r) r->size = 0, r->neg = false;
+        return;
+    }
+    // Magnitudes |a| / |b| and |a| % |b|; the quotient gets a spare limb for
+    // the Euclidean adjustment. One-limb operands stay on the stack.
+    Size qcap = n >= m ? n - m + 2 : 1;
+    Limb small[4], *buf = qcap + m <= 4 ? small : alloc_limbs(size_t(qcap) + m);
+    Limb *qm = buf, *rm = buf + qcap;
+    Size qn, rn;
+    if (n < m) {
+        qn = 0;
+        std::memcpy(rm, a.limbs, n * sizeof(Limb));
+        std::memset(rm + n, 0, (m - n) * sizeof(Limb));
+        rn = n;
+    } else {
+        divmod_mag(qm, rm, a.limbs, n, b.limbs, m);
+        qn = trim(qm, n - m + 1);
+        rn = trim(rm, m);
+    }
+    // a < 0 with a nonzero remainder: round the quotient away from zero and
+    // take the remainder from |b| down, so it is non-negative
+    if (a.neg && rn != 0) {
+        qm[qn] = 0;
+        Limb one = 1;
+        add_n(qm, qn + 1, &one, 1);
+        qn = trim(qm, qn + 1);
+        Limb borrow = 0;
+        for (Size i = 0; i < m; i++) rm[i] = subc(b.limbs[i], rm[i], borrow, &borrow);
+        rn = trim(rm, m);
+    }
+    if (q) {
+        std::memcpy(q->limbs, qm, qn * sizeof(Limb));
+        q->size = qn;
+        q->neg = qn != 0 && a.neg != b.neg;
+    }
+    if (r) {
+        std::memcpy(r->limbs, rm, rn * sizeof(Limb));
+        r->size = rn;
+        r->neg = false;
     }
-    if (v.neg) putchar('-');
-    while (pos > 0) putchar(buf[--pos]);
-    putchar('\n');
-    std::free(buf);
-    std::free(tmp);
+    if (buf != small) std::free(buf);
+}
+
+// Signed comparison: -1, 0 or 1
+[[nodiscard]] inline int cmp(const Raw& __restrict a, const Raw& __restrict b) {
+    if (a.neg != b.neg) return a.neg ? -1 : 1;
+    int c = cmp_mag(a, b);
+    return a.neg ? -c : c;
 }
 
 // --- Heap allocation helpers (for compiled code with unlimited size) ---
@@ -215,83 +868,313 @@ struct Var { Raw* ptr; Size cap; };
     return {p, cap};
 }
 
-inline void assign(Var& v, const Raw& value) {
-    Size needed = Raw::buf_size(value.size);
+// Ensure capacity for `limbs` limbs (realloc with doubling; keeps the value)
+inline void reserve(Var& v, Size limbs) {
+    Size needed = Raw::buf_size(limbs);
     if (needed > v.cap) {
         v.cap = v.cap * 2 > needed ? v.cap * 2 : needed;
         v.ptr = static_cast<Raw*>(std::realloc(v.ptr, v.cap));
     }
+}
+
+inline void assign(Var& v, const Raw& value) {
+    reserve(v, value.size);
     copy(*v.ptr, value);
 }
 
+// --- Scratch arena (temporaries of compiled code) ---
+// Temporaries are bump-allocated from one block as their sizes become known
+// and released together when their statement ends (release to a mark; marks
+// nest like statements). A statement that outgrows the block takes the rest
+// from the heap, since its earlier temporaries must not move; the block is
+// regrown to the high-water mark once nothing is live, so from then on that
+// statement fits and no temporary touches the heap or the stack.
+struct Arena {
+    struct alignas(std::max_align_t) Spill { Spill* next; size_t size; };  // heap block, header first
+
+    char* base = nullptr;
+    size_t cap = 0, top = 0;       // bytes
+    size_t spilled = 0, peak = 0;  // bytes live in spills; high-water mark of top + spilled
+    Spill* spill = nullptr;        // newest first
+
+    struct Mark { size_t top; Spill* spill; };
+    [[nodiscard]] Mark mark() const { return {top, spill}; }
+
+    [[nodiscard]] void* alloc_bytes(size_t n) {
+        n = (n + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+        if (top + n <= cap) [[likely]] return base + std::exchange(top, top + n);
+        return alloc_spill(n);
+    }
+    [[nodiscard]] Raw* alloc(Size limbs) { return static_cast<Raw*>(alloc_bytes(Raw::buf_size(limbs))); }
+
+    void release(Mark m) {
+        top = m.top;
+        if (spill != m.spill || peak > cap) [[unlikely]] settle(m);
+    }
+
+    Arena() = default;
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+    ~Arena() {
+        while (spill) std::free(std::exchange(spill, spill->next));
+        std::free(base);
+    }
+
+    // Releases what was allocated during its lifetime
+    struct Scope {
+        Arena& arena;
+        Mark m;
+        explicit Scope(Arena& a) : arena(a), m(a.mark()) {}
+        ~Scope() { arena.release(m); }
+    };
+
+private:
+    [[gnu::noinline]] void* alloc_spill(size_t n) {
+        auto* s = static_cast<Spill*>(std::malloc(sizeof(Spill) + n));
+        *s = {std::exchange(spill, s), n};
+        spilled += n;
+        peak = std::max(peak, top + spilled);
+        return s + 1;
+    }
+
+    // Frees the spills made since m; regrows the block once nothing is live
+    [[gnu::noinline]] void settle(Mark m) {
+        while (spill != m.spill) {
+            spilled -= spill->size;
+            std::free(std::exchange(spill, spill->next));
+        }
+        if (top == 0 && !spill && peak > cap) {
+            std::free(base);
+            cap = std::max(peak, cap * 2);
+            base = static_cast<char*>(std::malloc(cap));
+        }
+    }
+};
+
+// --- In-place compound updates: x := x + b, x := x - b ---
+// Work directly on the variable's limbs, no temporary and no copy. Capacity
+// grows only when b is longer than x or the final carry spills into a new
+// limb, so a counter update is O(1) amortized. b may alias the variable.
+
+// v += (bneg ? -|b| : |b|)
+[[gnu::hot]] inline void add_assign_signed(Var& v, const Raw& b, bool bneg) {
+    if (b.size == 0) return;
+    if (b.size > v.ptr->size) {
+        reserve(v, b.size);
+        auto& a = *v.ptr;
+        std::memset(a.limbs + a.size, 0, (b.size - a.size) * sizeof(Limb));
+        if (a.size == 0) a.neg = bneg;
+        a.size = b.size;
+    }
+    auto& a = *v.ptr;
+    if (a.neg == bneg) {  // |a| += |b|
+        if (add_n(a.limbs, a.size, b.limbs, b.size)) {
+            reserve(v, a.size + 1);
+            v.ptr->limbs[v.ptr->size++] = 1;
+        }
+        return;
+    }
+    if (a.size > b.size) sub_n(a.limbs, a.size, b.limbs, b.size);  // |a| -= |b|
+    else {  // equal lengths: the highest differing limb orders them (see diff_mag)
+        Size n = a.size = diff_len(a.limbs, b.limbs, a.size);
+        if (n > 0 && a.limbs[n-1] > b.limbs[n-1]) sub_nn(a.limbs, a.limbs, b.limbs, n);
+        else if (n > 0) {  // |a| = |b| - |a|, sign flips
+            sub_nn(a.limbs, b.limbs, a.limbs, n);
+            a.neg = bneg;
+        }
+    }
+    while (a.size > 0 && a.limbs[a.size - 1] == 0) a.size--;
+    if (a.size == 0) a.neg = false;
+}
+
+inline void add_assign(Var& v, const Raw& b) { add_assign_signed(v, b, b.neg); }
+inline void sub_assign(Var& v, const Raw& b) { add_assign_signed(v, b, !b.neg); }
+
+// v := v ± a * b in one step: the closed form of a counted accumulation loop
+// (Kind::MulAdd in e1.hpp). The product is a stack temporary; a and b may
+// alias each other but not the variable.
+inline void mul_add_assign(Var& v, const Raw& a, const Raw& b, bool sub) {
+    if (a.size == 0 || b.size == 0) return;
+    BIGINT_TMP(prod, mul_size(a, b));
+    mul(prod, a, b);
+    add_assign_signed(v, prod, prod.neg != sub);
+}
+
 [[nodiscard]] inline Var arg_init(int argc, char** argv, int idx) {
+    auto v = var_init();
     if (idx < argc) {
-        Size limbs_needed = std::strlen(argv[idx]) / 19 + 2;
-        auto* tmp = static_cast<Raw*>(std::malloc(Raw::buf_size(limbs_needed)));
-        from_str(*tmp, argv[idx]);
-        auto v = var_init();
-        assign(v, *tmp);
-        std::free(tmp);
-        return v;
+        if (auto* at = bad_digit(argv[idx])) bad_arg(argv[idx], at);
+        reserve(v, dec_limbs(std::strlen(argv[idx])));
+        from_str(*v.ptr, argv[idx]);
     }
-    return var_init();
+    return v;
 }
 
 // --- C++ wrapper class using shared assign() ---
-// Used by interpreter. Wraps Raw* with RAII.
+// Used by interpreter. Values whose magnitude fits in one limb are stored
+// inline (no heap allocation); a result that carries into a second limb is
+// promoted to a heap Var, which is then kept and reused for later values.
 
 class Int {
-    Var v_ = {};
+    Var v_ = {};  // heap storage; in use iff v_.cap != 0
+    alignas(Raw) unsigned char small_[Raw::buf_size(1)];  // inline Raw, capacity 1 limb
 
-    Raw& r() { return *v_.ptr; }
-    const Raw& r() const { return *v_.ptr; }
+    bool heap() const { return v_.cap != 0; }
+    Raw& small() { return *reinterpret_cast<Raw*>(small_); }
+    Raw& r() { return heap() ? *v_.ptr : small(); }
+    const Raw& r() const { return heap() ? *v_.ptr : *reinterpret_cast<const Raw*>(small_); }
+
+    void set(const Raw& val) {
+        if (!heap() && val.size <= 1) copy(small(), val);
+        else assign(v_, val);
+    }
+    void promote() {
+        if (!heap()) assign(v_, small());
+    }
 public:
-    Int() : v_(var_init()) {}
-    Int(int val) : v_(var_init()) { init(r(), val); }
-    Int(long long val) : v_(var_init()) { init(r(), val); }
+    Int() { init(small(), 0); }
+    Int(int val) { init(small(), val); }
+    Int(long long val) { init(small(), val); }
     explicit Int(const char* s) {
-        Size limbs = std::strlen(s) / 18 + 2;
+        Size limbs = dec_limbs(std::strlen(s));
         v_.ptr = static_cast<Raw*>(std::malloc(Raw::buf_size(limbs)));
         v_.cap = Raw::buf_size(limbs);
         from_str(r(), s);
     }
-    ~Int() { std::free(v_.ptr); }
+    ~Int() { if (heap()) std::free(v_.ptr); }
+    // Parses s (valid per bad_digit) into this value's heap storage, which
+    // is reused if large enough
+    Int& set_str(const char* s) {
+        reserve(v_, dec_limbs(std::strlen(s)));
+        from_str(*v_.ptr, s);
+        return *this;
+    }
 
-    Int(const Int& o) : v_(var_init()) { assign(v_, o.r()); }
-    Int(Int&& o) noexcept : v_(o.v_) { o.v_ = {}; }
+    Int(const Int& o) { init(small(), 0); set(o.r()); }
+    Int(Int&& o) noexcept {
+        if (o.heap()) { v_ = o.v_; o.v_ = {}; init(o.small(), 0); }
+        else copy(small(), o.small());
+    }
     Int& operator=(const Int& o) {
-        if (this != &o) assign(v_, o.r());
+        if (this != &o) set(o.r());
         return *this;
     }
     Int& operator=(Int&& o) noexcept {
-        if (this != &o) { std::free(v_.ptr); v_ = o.v_; o.v_ = {}; }
+        if (this == &o) return *this;
+        if (o.heap()) {
+            if (heap()) std::free(v_.ptr);
+            v_ = o.v_; o.v_ = {}; init(o.small(), 0);
+        } else set(o.small());
         return *this;
     }
+    // Exchanges values with their storage: O(1), nothing allocated or freed
+    friend void swap(Int& a, Int& b) noexcept {
+        std::swap(a.v_, b.v_);
+        std::swap(a.small_, b.small_);
+    }
 
     Int operator+(const Int& o) const {
         Int res;
+        if (add1(res.small(), r(), o.r(), o.r().neg)) return res;
         BIGINT_TMP(tmp, add_size(r(), o.r()));
         add(tmp, r(), o.r());
-        assign(res.v_, tmp);
+        res.set(tmp);
         return res;
     }
     Int operator-(const Int& o) const {
         Int res;
+        if (add1(res.small(), r(), o.r(), !o.r().neg)) return res;
         BIGINT_TMP(tmp, sub_size(r(), o.r()));
         sub(tmp, r(), o.r());
-        assign(res.v_, tmp);
+        res.set(tmp);
         return res;
     }
+    // In-place x := x ± o (add1 fast path while inline, add_assign kernels once on the heap)
+    Int& operator+=(const Int& o) {
+        if (!heap() && add1(small(), small(), o.r(), o.r().neg)) return *this;
+        promote();
+        add_assign(v_, o.r());
+        return *this;
+    }
+    Int& operator-=(const Int& o) {
+        if (!heap() && add1(small(), small(), o.r(), !o.r().neg)) return *this;
+        promote();
+        sub_assign(v_, o.r());
+        return *this;
+    }
+    // In-place x := x ± a * b (see mul_add_assign)
+    Int& mul_add(const Int& a, const Int& b, bool sub) {
+        promote();
+        mul_add_assign(v_, a.r(), b.r(), sub);
+        return *this;
+    }
+    // x := Σ ±t[i].v in one pass (see sum); any operand may be x itself. Once
+    // on the heap the sum is written into x's storage, else into a stack
+    // temporary.
+    struct Term { const Int* v; bool sub; };
+    Int& set_sum(const Term* t, Size k) {
+        bigint::Term raw[k];
+        for (Size i = 0; i < k; i++) raw[i] = {&t[i].v->r(), t[i].sub};
+        Size n = bigint::sum_size(raw, k);
+        if (!heap()) {
+            BIGINT_TMP(tmp, n);
+            bigint::sum(tmp, raw, k);
+            set(tmp);
+            return *this;
+        }
+        const Raw* self = v_.ptr;
+        reserve(v_, n);  // may move x's value
+        for (Size i = 0; i < k; i++)
+            if (raw[i].v == self) raw[i].v = v_.ptr;
+        bigint::sum(*v_.ptr, raw, k);
+        return *this;
+    }
     Int operator-() const {
         Int res;
+        if (r().size <= 1) { neg(res.small(), r()); return res; }
         BIGINT_TMP(tmp, r().size);
         neg(tmp, r());
-        assign(res.v_, tmp);
+        res.set(tmp);
+        return res;
+    }
+
+    Int operator*(const Int& o) const {
+        Int res;
+        const Raw &a = r(), &b = o.r();
+        if (a.size <= 1 && b.size <= 1) {  // one-limb fast path
+            auto p = static_cast<DLimb>(a.size ? a.limbs[0] : Limb0) * (b.size ? b.limbs[0] : Limb0);
+            if (!(p >> LimbBits)) {
+                auto& s = res.small();
+                s.limbs[0] = static_cast<Limb>(p);
+                s.size = p != 0;
+                s.neg = p != 0 && a.neg != b.neg;
+                return res;
+            }
+        }
+        BIGINT_TMP(tmp, mul_size(a, b));
+        mul(tmp, a, b);
+        res.set(tmp);
+        return res;
+    }
+    // Euclidean division, x / 0 = x % 0 = 0 (see divmod)
+    Int operator/(const Int& o) const {
+        Int res;
+        BIGINT_TMP(tmp, div_size(r(), o.r()));
+        divmod(&tmp, nullptr, r(), o.r());
+        res.set(tmp);
+        return res;
+    }
+    Int operator%(const Int& o) const {
+        Int res;
+        BIGINT_TMP(tmp, mod_size(r(), o.r()));
+        divmod(nullptr, &tmp, r(), o.r());
+        res.set(tmp);
         return res;
     }
 
     bool operator==(const Int& o) const { return cmp_mag(r(), o.r()) == 0 && r().neg == o.r().neg; }
-    bool operator==(int val) const { Int t(val); return *this == t; }
+    std::strong_ordering operator<=>(const Int& o) const { return cmp(r(), o.r()) <=> 0; }
+    bool operator==(int val) const { return eq_si(r(), val); }
     bool operator<(int) const { return r().neg && !is_zero(r()); }
     explicit operator bool() const { return !is_zero(r()); }
 
@@ -0,0 +1,372 @@
+// PL/0 Levels 1-2 — Persistent program cache ($E1_CACHE_DIR)
+//
+// Schedulers run the same program over and over with different arguments.
+// With E1_CACHE_DIR set, the first run stores what the frontend (and, for
+// compiled modes, the code generator) produced, and later runs of the same
+// source load it instead of rebuilding it:
+//   e1, e2            the optimized Ast (pack/unpack below); resolve() reruns
+//   e1_compile        the emitted C++ or LLVM IR text
+//   e1 --jit          the optimized module's bitcode and the native object
+//                     (e1_jit.hpp)
+// An entry is <dir>/<key>.e1c. The key is a 128-bit hash of the source text,
+// the mode (which tool, flags such as -O0 or --llvm), the configuration
+// (LEVEL, INT_BITS, LIMB_BITS), the format version and the identity of the
+// executable, so a rebuilt binary never sees the entries of the old one. The
+// file is a Header followed by its sections, each 8-byte aligned, so it is
+// used straight from the mapping read_file makes: the Ast's identifier
+// spellings view the entry, which must outlive it. Entries are written to a
+// temporary file and renamed into place, so a reader never sees a partial
+// one.
+//
+// A hit refreshes the entry's mtime. When a store takes the directory over
+// $E1_CACHE_MAX bytes (default 256 MiB), the least recently used entries are
+// removed. Lookups are counted in <dir>/stats (under flock); `e1
+// --cache-stats` prints the counts and the directory's size. Without
+// E1_CACHE_DIR nothing is hashed, read or written. The cache is best effort:
+// an entry that cannot be read is a miss and one that cannot be written is
+// dropped.
+#pragma once
+#include "e1.hpp"
+#include "e1_opt.hpp"
+#include <bit>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <optional>
+#include <sys/file.h>
+
+namespace cache {
+
+// Bump when the entry layout or any payload format changes
+constexpr uint32_t VERSION = 1;
+constexpr uint64_t DEFAULT_MAX = uint64_t(256) << 20;
+constexpr size_t MAX_SECTIONS = 4;
+
+struct Key {
+    uint64_t lo = 0, hi = 0;
+    bool operator==(const Key&) const = default;
+    std::string hex() const { return std::format("{:016x}{:016x}", hi, lo); }
+};
+
+inline uint64_t fmix(uint64_t k) {
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ULL;
+    return k ^ (k >> 33);
+}
+
+// MurmurHash3 x64_128 with a 64-bit seed (not cryptographic: the cache
+// directory is trusted)
+inline Key hash(std::string_view s, uint64_t seed) {
+    constexpr uint64_t c1 = 0x87c37b91114253d5ULL, c2 = 0x4cf5ad432745937fULL;
+    uint64_t h1 = seed, h2 = seed;
+    auto mix1 = [&](uint64_t k) { h1 ^= std::rotl(k * c1, 31) * c2; };
+    auto mix2 = [&](uint64_t k) { h2 ^= std::rotl(k * c2, 33) * c1; };
+    size_t i = 0;
+    for (; i + 16 <= s.size(); i += 16) {
+        uint64_t k[2];
+        std::memcpy(k, s.data() + i, 16);
+        mix1(k[0]);
+        h1 = (std::rotl(h1, 27) + h2) * 5 + 0x52dce729;
+        mix2(k[1]);
+        h2 = (std::rotl(h2, 31) + h1) * 5 + 0x38495ab5;
+    }
+    if (i < s.size()) {
+        uint64_t k[2] = {};
+        std::memcpy(k, s.data() + i, s.size() - i);
+        mix1(k[0]);
+        mix2(k[1]);
+    }
+    h1 ^= s.size();
+    h2 ^= s.size();
+    h1 += h2;
+    h2 += h1;
+    h1 = fmix(h1);
+    h2 = fmix(h2);
+    h1 += h2;
+    h2 += h1;
+    return {h1, h2};
+}
+
+// $E1_CACHE_DIR, created on first use; nullopt when unset or empty
+inline const std::optional<std::string>& dir() {
+    static const std::optional<std::string> d = []() -> std::optional<std::string> {
+        const char* env = std::getenv("E1_CACHE_DIR");
+        if (!env || !*env) return std::nullopt;
+        mkdir(env, 0777);
+        return env;
+    }();
+    return d;
+}
+
+// $E1_CACHE_MAX in bytes
+inline uint64_t limit() {
+    const char* env = std::getenv("E1_CACHE_MAX");
+    uint64_t max = DEFAULT_MAX;
+    if (env) std::from_chars(env, env + std::strlen(env), max);
+    return max;
+}
+
+// Size and mtime of the running executable, so each build has its own entries
+inline std::string build_id() {
+    struct stat st = {};
+    stat("/proc/self/exe", &st);
+    return std::format("{}.{}.{}", st.st_size, st.st_mtim.tv_sec, st.st_mtim.tv_nsec);
+}
+
+inline Key key(std::string_view text, std::string_view mode) {
+    static const std::string exe = build_id();
+    auto cfg = std::format("{} level={} int_bits={} limb_bits={} v{} exe={}", mode, LEVEL, INT_BITS, LIMB_BITS,
+                           VERSION, exe);
+    Key c = hash(cfg, 0);
+    return hash(text, c.lo ^ c.hi);
+}
+
+inline std::string path(const Key& k) { return std::format("{}/{}.e1c", *dir(), k.hex()); }
+
+struct Header {
+    char magic[4];
+    uint32_t version;
+    Key key;
+    uint32_t level, int_bits, limb_bits, count;  // count: sections used
+    uint64_t sizes[MAX_SECTIONS];
+};
+
+inline Header header(const Key& k, size_t count) {
+    return {{'E', '1', 'C', '\0'}, VERSION, k, uint32_t(LEVEL), uint32_t(INT_BITS), uint32_t(LIMB_BITS),
+            uint32_t(count), {}};
+}
+
+constexpr size_t align8(size_t n) { return (n + 7) & ~size_t(7); }
+
+// A mapped entry and views of its sections
+struct Entry {
+    Source file;
+    std::vector<std::string_view> sections;
+};
+
+// ---------- Statistics ----------
+
+struct Stats {
+    uint64_t hits = 0, misses = 0;
+};
+
+inline Stats read_stats(int fd) {
+    Stats s;
+    if (pread(fd, &s, sizeof s, 0) != ssize_t(sizeof s)) s = {};
+    return s;
+}
+
+inline void tally(bool hit) {
+    int fd = open(std::format("{}/stats", *dir()).c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) return;
+    flock(fd, LOCK_EX);
+    Stats s = read_stats(fd);
+    ++(hit ? s.hits : s.misses);
+    (void)!pwrite(fd, &s, sizeof s, 0);
+    close(fd);  // releases the lock
+}
+
+// Entries in the directory with their sizes and last use
+struct Usage {
+    std::vector<std::pair<std::filesystem::file_time_type, std::filesystem::path>> entries;
+    uint64_t bytes = 0;
+};
+
+inline Usage usage() {
+    namespace fs = std::filesystem;
+    Usage u;
+    std::error_code ec;
+    for (auto& de : fs::directory_iterator(*dir(), ec)) {
+        if (de.path().extension() != ".e1c") continue;
+        auto size = de.file_size(ec);
+        auto time = de.last_write_time(ec);
+        if (ec) continue;  // removed meanwhile
+        u.entries.emplace_back(time, de.path());
+        u.bytes += size;
+    }
+    return u;
+}
+
+// e1 --cache-stats
+inline int print_stats() {
+    if (!dir()) {
+        std::println(stderr, "Error: E1_CACHE_DIR is not set");
+        return 1;
+    }
+    Stats s;
+    if (int fd = open(std::format("{}/stats", *dir()).c_str(), O_RDONLY); fd >= 0) {
+        flock(fd, LOCK_SH);
+        s = read_stats(fd);
+        close(fd);
+    }
+    auto u = usage();
+    std::println("{}: {} hits, {} misses, {} entries, {} bytes (limit {})", *dir(), s.hits, s.misses,
+                 u.entries.size(), u.bytes, limit());
+    return 0;
+}
+
+// ---------- Entries ----------
+
+// Removes least recently used entries until the directory fits the limit,
+// sparing `keep` (the entry just stored)
+inline void evict(const std::string& keep) {
+    auto u = usage();
+    uint64_t max = limit();
+    if (u.bytes <= max) return;
+    std::ranges::sort(u.entries);
+    std::error_code ec;
+    for (auto& [time, p] : u.entries) {
+        if (u.bytes <= max) break;
+        if (p == keep) continue;
+        auto size = std::filesystem::file_size(p, ec);
+        if (!ec && std::filesystem::remove(p, ec)) u.bytes -= size;
+    }
+}
+
+inline std::optional<Entry> validate(Source file, const Key& k, size_t count) {
+    auto text = file.text();
+    Header h;
+    if (text.size() < sizeof h) return std::nullopt;
+    std::memcpy(&h, text.data(), sizeof h);
+    if (std::memcmp(h.magic, "E1C", 4) != 0 || h.version != VERSION || h.key != k || h.level != uint32_t(LEVEL) ||
+        h.int_bits != uint32_t(INT_BITS) || h.limb_bits != uint32_t(LIMB_BITS) || h.count != count)
+        return std::nullopt;
+    Entry e;
+    size_t at = align8(sizeof h);
+    for (size_t i = 0; i < count; ++i) {
+        if (h.sizes[i] > text.size() - std::min(at, text.size())) return std::nullopt;
+        e.sections.push_back(text.substr(at, h.sizes[i]));
+        at = align8(at + h.sizes[i]);
+    }
+    if (at != align8(text.size())) return std::nullopt;
+    e.file = std::move(file);  // the mapping, and so the views, stay put
+    return e;
+}
+
+// The entry for k with `count` sections, counting the lookup; nullopt on a
+// miss (also when the cache is off)
+inline std::optional<Entry> load(const Key& k, size_t count) {
+    if (!dir()) return std::nullopt;
+    auto p = path(k);
+    std::optional<Entry> e;
+    if (auto file = read_file(p.c_str())) e = validate(std::move(*file), k, count);
+    tally(e.has_value());
+    if (e) utimensat(AT_FDCWD, p.c_str(), nullptr, 0);  // most recently used
+    return e;
+}
+
+inline bool write_all(int fd, const void* data, size_t size) {
+    auto* at = static_cast<const char*>(data);
+    while (size) {
+        ssize_t n = write(fd, at, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        at += n;
+        size -= size_t(n);
+    }
+    return true;
+}
+
+inline void store(const Key& k, std::initializer_list<std::string_view> sections) {
+    if (!dir() || sections.size() > MAX_SECTIONS) return;
+    Header h = header(k, sections.size());
+    size_t i = 0;
+    for (auto s : sections) h.sizes[i++] = s.size();
+    auto p = path(k);
+    auto tmp = std::format("{}.{}.tmp", p, getpid());
+    int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return;
+    static constexpr char zeros[8] = {};
+    bool ok = write_all(fd, &h, sizeof h) && write_all(fd, zeros, align8(sizeof h) - sizeof h);
+    for (auto s : sections)
+        ok = ok && write_all(fd, s.data(), s.size()) && write_all(fd, zeros, align8(s.size()) - s.size());
+    ok = close(fd) == 0 && ok;
+    if (!ok || rename(tmp.c_str(), p.c_str()) != 0) {
+        unlink(tmp.c_str());
+        return;
+    }
+    evict(p);
+}
+
+// ---------- Programs ----------
+
+// Ast payload: u32 node, list and identifier counts and the root; u32 xs,
+// ys, lists and the end offset of each spelling; u8 kinds and ops; the
+// spellings back to back. slots are not stored: resolve() fills them in.
+inline std::string pack(const Ast& a) {
+    std::string out;
+    auto put = [&](const auto& v) {
+        out.append(reinterpret_cast<const char*>(v.data()), v.size() * sizeof v[0]);
+    };
+    std::vector<uint32_t> ends;
+    uint32_t end = 0;
+    for (auto s : a.spellings) ends.push_back(end += uint32_t(s.size()));
+    put(std::vector<uint32_t>{uint32_t(a.kinds.size()), uint32_t(a.lists.size()), uint32_t(ends.size()), a.root});
+    put(a.xs);
+    put(a.ys);
+    put(a.lists);
+    put(ends);
+    put(a.kinds);
+    put(a.ops);
+    for (auto s : a.spellings) out.append(s);
+    return out;
+}
+
+// The Ast in a pack()ed payload, which its spellings view; nullopt if the
+// payload is inconsistent
+inline std::optional<Ast> unpack(std::string_view in) {
+    uint32_t n[4];
+    if (in.size() < sizeof n) return std::nullopt;
+    std::memcpy(n, in.data(), sizeof n);
+    auto [nodes, nlists, nids, root] = n;
+    size_t fixed = sizeof n + 4 * (2 * size_t(nodes) + nlists + nids) + 2 * size_t(nodes);
+    if (in.size() < fixed) return std::nullopt;
+    size_t at = sizeof n;
+    auto get = [&](auto& v, size_t count) {
+        v.resize(count);
+        std::memcpy(v.data(), in.data() + at, count * sizeof v[0]);
+        at += count * sizeof v[0];
+    };
+    Ast a;
+    std::vector<uint32_t> ends;
+    get(a.xs, nodes);
+    get(a.ys, nodes);
+    get(a.lists, nlists);
+    get(ends, nids);
+    get(a.kinds, nodes);
+    get(a.ops, nodes);
+    a.root = root;
+    uint32_t begin = 0;
+    for (auto end : ends) {
+        if (end < begin || end > in.size() - fixed) return std::nullopt;
+        a.spellings.push_back(in.substr(fixed + begin, end - begin));
+        begin = end;
+    }
+    if (fixed + begin != in.size() || root >= nodes) return std::nullopt;
+    return a;
+}
+
+// The program in `text`, parsed and optimized (unless !optimize), from the
+// cache when it has it; the Ast may view `entry`, which must outlive it
+inline std::expected<Ast, std::string> program(std::string_view text, bool optimize, Entry& entry) {
+    std::optional<Key> k;
+    if (dir()) {
+        k = key(text, optimize ? "ast -O1" : "ast -O0");
+        if (auto e = load(*k, 1)) {
+            if (auto a = unpack(e->sections[0])) {
+                entry = std::move(*e);
+                return std::move(*a);
+            }
+        }
+    }
+    auto prog = parse_program(text);
+    if (!prog) return prog;
+    if (optimize) opt::optimize(*prog);
+    if (k) store(*k, {pack(*prog)});
+    return prog;
+}
+
+} // namespace cache
@@ -0,0 +1,205 @@
+// PL/0 Levels 1-2 — Closure-compiled execution engine (C++23)
+//
+// Compiles the resolved AST once into a tree of pre-bound function objects:
+// every node's dispatch decision (node kind, operator, operand slots,
+// literal values) is made at compile time and captured, so running the
+// program is just nested indirect calls. Expression closures return a
+// reference to their result (a variable's register, a captured literal, or
+// a temporary owned by the closure), so operands are never copied.
+//
+// Loop control is a returned Flow status, not an exception.
+#pragma once
+#include "e1.hpp"
+#include "e1_par.hpp"
+#include <algorithm>
+#include <functional>
+
+namespace closure {
+
+using ExprFn = std::function<const Int&(Int*)>;
+using StmtFn = std::function<Flow(Int*)>;
+
+struct Compiler {
+    const Ast& a;
+    unsigned threads = 0;  // > 1: marked loops (par::mark) run on that many threads
+    uint32_t nregs = 0;    // register file size, for par::reduce
+
+    ExprFn expr(Node x) {
+        switch (a.kind(x)) {
+        case Kind::Num:
+            return [k = Int(a.val(x))](Int*) -> const Int& { return k; };
+        case Kind::Var:
+            return [s = a.slot(x)](Int* r) -> const Int& { return r[s]; };
+        case Kind::Neg:
+            return [e = expr(a.kid(x)), t = Int()](Int* r) mutable -> const Int& {
+                t = -e(r);
+                return t;
+            };
+        case Kind::Bin: break;
+        default: return [k = Int(0)](Int*) -> const Int& { return k; };
+        }
+        // Chains of + and - add all their operands at once
+        if (std::vector<Addend> terms; sum_terms(a, x, terms)) {
+            std::vector<ExprFn> ops;
+            std::vector<SumTerm> ts;
+            for (auto [y, sub] : terms) {
+                ops.push_back(expr(y));
+                ts.push_back({nullptr, sub});
+            }
+            return [ops = std::move(ops), ts = std::move(ts), t = Int()](Int* r) mutable -> const Int& {
+                for (size_t i = 0; i < ops.size(); ++i) ts[i].v = &ops[i](r);
+                sum(t, ts.data(), uint32_t(ts.size()));
+                return t;
+            };
+        }
+        Node lhs = a.lhs(x), rhs = a.rhs(x);
+        if (a.op(x) != '+' && a.op(x) != '-')
+            return [op = a.op(x), l = expr(lhs), rr = expr(rhs), t = Int()](Int* r) mutable -> const Int& {
+                t = binop(op, l(r), rr(r));
+                return t;
+            };
+        // Variable operands are read straight from the register file
+        if (a.kind(lhs) == Kind::Var && a.kind(rhs) == Kind::Var) {
+            if (a.op(x) == '+')
+                return [l = a.slot(lhs), c = a.slot(rhs), t = Int()](Int* r) mutable -> const Int& {
+                    t = r[l] + r[c];
+                    return t;
+                };
+            return [l = a.slot(lhs), c = a.slot(rhs), t = Int()](Int* r) mutable -> const Int& {
+                t = r[l] - r[c];
+                return t;
+            };
+        }
+        if (a.op(x) == '+')
+            return [l = expr(lhs), rr = expr(rhs), t = Int()](Int* r) mutable -> const Int& {
+                t = l(r) + rr(r);
+                return t;
+            };
+        return [l = expr(lhs), rr = expr(rhs), t = Int()](Int* r) mutable -> const Int& {
+            t = l(r) - rr(r);
+            return t;
+        };
+    }
+
+    StmtFn loop(Node x) {
+        auto body = stmt(a.kid(x));
+        if (!body) body = [](Int*) { return Flow::Next; };
+        return [body = std::move(body)](Int* r) {
+            while (body(r) == Flow::Next) {}
+            return Flow::Next;
+        };
+    }
+
+    // A marked loop on threads: closures keep temporaries, so every chunk
+    // runs a copy of its own; the loop runs here if par::reduce declines
+    StmtFn reduction(Node x) {
+        auto red = par::analyze(a, x);
+        std::vector<uint32_t> accs;
+        for (auto id : red->accs) accs.push_back(uint32_t(a.slots[id]));
+        std::vector<StmtFn> chunks;
+        for (unsigned i = 0; i < threads; ++i) chunks.push_back(loop(x));
+        return [seq = loop(x), chunks = std::move(chunks), count = uint32_t(a.slots[red->count]),
+                accs = std::move(accs), n = nregs, k = threads](Int* r) {
+            if (!par::reduce({r, n}, count, accs, k, [&](unsigned i, std::vector<Int>& mine) { chunks[i](mine.data()); }))
+                seq(r);
+            return Flow::Next;
+        };
+    }
+
+    // Returns an empty StmtFn for statements with no runtime effect (declarations)
+    StmtFn stmt(Node x) {
+        switch (a.kind(x)) {
+        case Kind::Assign: {
+            if (a.op(x) == 'm')
+                return [s = a.slot(x), y = a.slot(a.kid(x))](Int* r) {
+                    move_int(r[s], r[y]);
+                    return Flow::Next;
+                };
+            char op;
+            if (Node d = self_update(a, x, &op); d != NO_NODE) {
+                if (op == '+')
+                    return [s = a.slot(x), e = expr(d)](Int* r) {
+                        r[s] += e(r);
+                        return Flow::Next;
+                    };
+                return [s = a.slot(x), e = expr(d)](Int* r) {
+                    r[s] -= e(r);
+                    return Flow::Next;
+                };
+            }
+            return [s = a.slot(x), e = expr(a.kid(x))](Int* r) {
+                r[s] = e(r);
+                return Flow::Next;
+            };
+        }
+        case Kind::Block: {
+            std::vector<StmtFn> body;
+            for (auto s : a.items(x))
+                if (auto f = stmt(s)) body.push_back(std::move(f));
+            if (body.size() == 1) return std::move(body[0]);
+            return [body = std::move(body)](Int* r) {
+                for (auto& f : body)
+                    if (f(r) == Flow::Break) return Flow::Break;
+                return Flow::Next;
+            };
+        }
+        case Kind::Loop: return a.op(x) == 'p' && threads > 1 ? reduction(x) : loop(x);
+        case Kind::BreakIfz: {
+            // break_ifz a - b: zero exactly when the operands are equal
+            if (Node d = a.kid(x); a.kind(d) == Kind::Bin && a.op(d) == '-')
+                return [l = expr(a.lhs(d)), rr = expr(a.rhs(d))](Int* r) {
+                    return l(r) == rr(r) ? Flow::Break : Flow::Next;
+                };
+            return [c = expr(a.kid(x))](Int* r) { return c(r) == 0 ? Flow::Break : Flow::Next; };
+        }
+        case Kind::Print:
+            return [e = expr(a.kid(x))](Int* r) {
+                print_int(e(r));
+                return Flow::Next;
+            };
+        case Kind::Break: return [](Int*) { return Flow::Break; };
+        case Kind::Case: {
+            std::vector<std::pair<ExprFn, StmtFn>> arms;
+            for (auto arm : a.items(x)) {
+                auto body = stmt(a.kid(arm));
+                if (!body) body = [](Int*) { return Flow::Next; };
+                arms.emplace_back(expr(a.guard(arm)), std::move(body));
+            }
+            return [arms = std::move(arms)](Int* r) {
+                for (auto& [cond, body] : arms)
+                    if (!(cond(r) == 0)) return body(r);
+                return Flow::Next;
+            };
+        }
+        case Kind::MulAdd: {
+            if (a.acc(x) == NO_NODE)
+                return [n = a.slot(a.count(x)), loop = stmt(a.loop(x))](Int* r) {
+                    if (r[n] < 0) return loop(r);
+                    r[n] = 0;
+                    return Flow::Next;
+                };
+            return [acc = a.slot(a.acc(x)), n = a.slot(a.count(x)), op = a.op(x), e = expr(a.step(x)),
+                    loop = stmt(a.loop(x))](Int* r) {
+                if (r[n] < 0) return loop(r);
+                mul_add(r[acc], op, r[n], e(r));
+                r[n] = 0;
+                return Flow::Next;
+            };
+        }
+        default: return {};
+        }
+    }
+};
+
+// `prog` must have been annotated by resolve(); threads as for vm::compile
+inline StmtFn compile(const Ast& prog, unsigned threads = 0) {
+    return Compiler{prog, threads, uint32_t(std::ranges::max(prog.slots) + 1)}.stmt(prog.root);
+}
+
+// Runs over a register file indexed by slot. Returns false if a break_ifz
+// (or e2 break) outside any loop fired.
+inline bool run(const StmtFn& code, Int* regs) {
+    return code(regs) == Flow::Next;
+}
+
+} // namespace closure
@@ -0,0 +1,775 @@
+// PL/0 Levels 1-2 - Code generators: C++ and LLVM IR backends
+//
+// Two backends:
+//   - GenCpp: emits C++ using e1_bigint.hpp or _BitInt (through the macros
+//     in e1_preamble.hpp)
+//   - GenLLVM: emits LLVM IR, linked with e1_rt_bigint.ll
+// Both write to gen_out (stdout for e1_compile; gen_string captures the
+// output in memory for e1 --jit and the program cache).
+//
+// Bigint memory management (LLVM backend, INT_BITS=0):
+//   - Variables: heap-allocated via bi_assign() with realloc() and doubling strategy
+//     Each var has a (ptr, cap) pair; starts as (null, 0), first assignment allocates
+//   - Temporaries: taken from the program's scratch arena (bigint::Arena,
+//     %bi.arena) by fused bi_*_into calls that size, allocate and compute in
+//     one go, and released by bi_arena_reset after the statement
+//   This gives unlimited integer size with minimal allocation overhead, and
+//   no stack growth however large the values get.
+//
+// Hybrid integers (hybrid = true, both backends, bigint builds): values are
+// int64 under overflow checks and are promoted to bigints on the cold path
+// (e1_hybrid.hpp).
+//
+// Generated programs print through the shared buffer in e1_out.hpp and flush
+// it before main returns; unbuffered makes them write every line
+// immediately. A break outside any loop ends the program.
+//
+// Parallel loops (parallel = true, C++ backend): loops par::mark accepts run
+// on std::jthread workers, see GenCpp::reduction.
+#pragma once
+#include "e1.hpp"
+#include "e1_par.hpp"
+#include "e1_preamble.hpp"
+
+template <class... Args> void p(std::format_string<Args...> fmt, Args &&...args) {
+    std::print(gen_out, fmt, std::forward<Args>(args)...);
+}
+template <class... Args> std::string f(std::format_string<Args...> fmt, Args &&...args) {
+    return std::format(fmt, std::forward<Args>(args)...);
+}
+
+// C++ backend - unified code generation using runtime macros
+struct GenCpp {
+    bool unbuffered = false;
+    bool hybrid = false;  // int64 with bigint promotion (e1_hybrid.hpp)
+    bool parallel = false;  // reduction loops on threads (e1_par.hpp)
+    unsigned threads = 0;   // their workers at most; 0: one per core
+    int lbl = 0, tmp = 0;
+    std::vector<int> ex = {};
+    bool orphan = false;  // a break outside any loop jumps to Lend
+    const Ast *a = nullptr;
+
+    std::string brk() {
+        if (ex.empty()) return orphan = true, "Lend";
+        return f("L{}", ex.back());
+    }
+
+    std::string lit(int v) {
+        auto t = f("t{}", tmp++);
+        p("  LIT({}, {});\n", t, v);
+        return t;
+    }
+
+    // " TEMPS;" when x computes temporaries of unknown size (literals and
+    // comparison results are one-limb stack values)
+    const char* temps(Node x) {
+        switch (a->kind(x)) {
+        case Kind::Neg: return " TEMPS;";
+        case Kind::Bin:
+            if (!is_cmp(a->op(x))) return " TEMPS;";
+            return *temps(a->lhs(x)) ? " TEMPS;" : temps(a->rhs(x));
+        default: return "";
+        }
+    }
+
+    // Expression codegen - emits temp declaration, returns expression string
+    std::string e(Node x) {
+        switch (a->kind(x)) {
+        case Kind::Num:
+            return lit(a->val(x));
+        case Kind::Var:
+            return f("REF({})", a->name(x).str);
+        case Kind::Neg: {
+            auto v = e(a->kid(x)), t = f("t{}", tmp++);
+            p("  NEG({}, {});\n", t, v);
+            return t;
+        }
+        case Kind::Bin: {
+            // Chains of + and - are one SUM of their operands (hybrid
+            // values keep their int64 fast path per operator)
+            if (std::vector<Addend> terms; !hybrid && sum_terms(*a, x, terms)) {
+                std::string ops;
+                for (auto [y, sub] : terms) ops += f(", {}({})", sub ? "MINUS" : "PLUS", e(y));
+                auto t = f("t{}", tmp++);
+                p("  SUM({}{});\n", t, ops);
+                return t;
+            }
+            char op = a->op(x);
+            auto l = e(a->lhs(x)), r = e(a->rhs(x)), t = f("t{}", tmp++);
+            if (is_cmp(op)) {
+                p("  CMP({}, {}, {}, {});\n", t, op_str(op), l, r);
+                return t;
+            }
+            auto m = op == '+' ? "ADD" : op == '-' ? "SUB" : op == '*' ? "MUL" : op == '/' ? "DIV" : "MOD";
+            p("  {}({}, {}, {});\n", m, t, l, r);
+            return t;
+        }
+        default:
+            return "0";
+        }
+    }
+
+    void s(Node x, int d = 1) {
+        auto ind = [&] { for (int i = 0; i < d; i++) p("  "); };
+        switch (a->kind(x)) {
+        case Kind::Assign: {
+            if (a->op(x) == 'm') {
+                ind(); p("MOVE({}, {});\n", a->name(x).str, a->name(a->kid(x)).str);
+                break;
+            }
+            char op = 0;
+            Node u = self_update(*a, x, &op);
+            Node v = u != NO_NODE ? u : a->kid(x);
+            ind(); p("{{{}\n", temps(v));
+            auto t = e(v);
+            ind(); p("{}({}, {}); }}\n", u == NO_NODE ? "ASSIGN" : op == '+' ? "ADD_ASSIGN" : "SUB_ASSIGN", a->name(x).str, t);
+            break;
+        }
+        case Kind::Block:
+            for (auto y : a->items(x)) s(y, d);
+            break;
+        case Kind::Loop:
+            if (a->op(x) == 'p') reduction(x, d);
+            else loop(x, d);
+            break;
+        case Kind::BreakIfz: {
+            ind(); p("{{{}\n", temps(a->kid(x)));
+            auto t = e(a->kid(x));
+            ind(); p("if (IS_ZERO({})) goto {}; }}\n", t, brk());
+            break;
+        }
+        case Kind::Print: {
+            ind(); p("{{{}\n", temps(a->kid(x)));
+            auto t = e(a->kid(x));
+            ind(); p("PRINT({}); }}\n", t);
+            break;
+        }
+        case Kind::Break:
+            ind(); p("goto {};\n", brk());
+            break;
+        case Kind::Case: {
+            // Arms nest as if/else; each arm's block scopes its guard temporaries
+            auto arms = a->items(x);
+            for (auto arm : arms) {
+                ind(); p("{{{}\n", temps(a->guard(arm)));
+                auto t = e(a->guard(arm));
+                ind(); p("if (!IS_ZERO({})) {{\n", t);
+                s(a->kid(arm), d + 1);
+                ind(); p("}} else\n");
+            }
+            ind(); p(";{}\n", std::string(arms.size(), '}'));
+            break;
+        }
+        case Kind::MulAdd: {
+            // Closed form for n >= 0, the original loop otherwise
+            auto n = a->name(a->count(x)).str;
+            ind(); p("if (IS_NEG(REF({}))) {{\n", n);
+            s(a->loop(x), d + 1);
+            ind(); p("}} else {{{}\n", a->acc(x) != NO_NODE ? temps(a->step(x)) : "");
+            if (a->acc(x) != NO_NODE) {
+                auto t = e(a->step(x));
+                ind(); p("{}({}, REF({}), {});\n", a->op(x) == '+' ? "MUL_ADD_ASSIGN" : "MUL_SUB_ASSIGN", a->name(a->acc(x)).str, n, t);
+            }
+            auto z = lit(0);
+            ind(); p("ASSIGN({}, {}); }}\n", n, z);
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    void loop(Node x, int d) {
+        int z = lbl++;
+        ex.push_back(z);
+        for (int i = 0; i < d; i++) p("  ");
+        p("for(;;) {{\n");
+        s(a->kid(x), d + 1);
+        for (int i = 0; i < d; i++) p("  ");
+        p("}} L{}:;\n", z);
+        ex.pop_back();
+    }
+
+    // A loop marked by par::mark: par_k workers each run their share of the
+    // count (the body without the decrement) over their own copies of the
+    // assigned variables, and their accumulators are added to the shared
+    // ones in worker order. The loop itself when par_chunks declines.
+    void reduction(Node x, int d) {
+        auto r = par::analyze(*a, x);
+        auto name = [&](uint32_t id) { return a->spellings[id]; };
+        auto ind = [&](int more) { for (int i = 0; i < d + more; i++) p("  "); };
+        ind(0); p("if (int64_t par_n = par_count(REF({})); unsigned par_k = par_chunks(par_n, {})) {{\n", name(r->count), threads);
+        for (auto id : r->accs) { ind(1); p("PARTS({}, par_k);\n", name(id)); }
+        ind(1); p("{{\n");
+        ind(2); p("std::vector<std::jthread> par_workers;\n");
+        ind(2); p("for (unsigned par_i = 0; par_i < par_k; par_i++)\n");
+        ind(3); p("par_workers.emplace_back([&, par_i] {{\n");
+        ind(4); p("PRIVATE_TEMPS;\n");
+        for (auto id : r->privates) { ind(4); p("VAR({});\n", name(id)); }
+        for (auto id : r->accs) { ind(4); p("VAR({});\n", name(id)); }
+        ind(4); p("for (int64_t par_j = par_n / par_k + (int64_t(par_i) < par_n % par_k); par_j > 0; par_j--) {{\n");
+        for (Node y : r->body)
+            if (y != r->dec) s(y, d + 5);
+        ind(4); p("}}\n");
+        for (auto id : r->accs) { ind(4); p("KEEP({}, par_i);\n", name(id)); }
+        for (auto id : r->privates) { ind(4); p("DROP({});\n", name(id)); }
+        ind(3); p("}});\n");
+        ind(1); p("}}\n");
+        ind(1); p("for (unsigned par_i = 0; par_i < par_k; par_i++) {{");
+        for (auto id : r->accs) p(" ADD_PART({}, par_i);", name(id));
+        p(" }}\n");
+        ind(1); p("{{\n");
+        auto z = lit(0);
+        ind(1); p("ASSIGN({}, {}); }}\n", name(r->count), z);
+        ind(0); p("}} else {{\n");
+        loop(x, d + 1);
+        ind(0); p("}}\n");
+    }
+
+    void gen(Ast &prog) {
+        auto syms = resolve(prog);
+        if (parallel) par::mark(prog);
+        a = &prog;
+        cpp_preamble(hybrid);
+        for (Node n = 0; n < prog.kinds.size(); ++n)
+            if (prog.kind(n) == Kind::Loop && prog.op(n) == 'p') {
+                std::println(gen_out, "{}", CPP_PAR_PREAMBLE);
+                break;
+            }
+        p("int main(int argc, char** argv) {{\n");
+        for (size_t i = ARG_COUNT; i < syms.size(); ++i)
+            p("  VAR({});\n", syms[i].name);
+        for (int i = 1; i <= ARG_COUNT; ++i)
+            p("  ARG(arg{0}, {0});\n", i);
+        if (unbuffered)
+            p("  out::unbuffered = true;\n");
+        s(prog.root);
+        if (orphan)
+            p("Lend:\n");
+        p("  out::flush();\n}}\n");
+    }
+};
+
+// LLVM backend
+struct GenLLVM {
+    bool unbuffered = false;
+    bool hybrid = false;  // int64 with bigint promotion (e1_hybrid.hpp)
+    int t = 0, lbl = 0;
+    std::vector<int> ex;
+    bool orphan = false;  // a break outside any loop branches to %Lend
+    const Ast *a = nullptr;
+
+    std::string brk() {
+        if (ex.empty()) return orphan = true, "Lend";
+        return f("L{}", ex.back());
+    }
+    bool bi = (INT_BITS == 0);
+    std::string I = bi ? "ptr" : f("i{}", INT_BITS);
+
+    std::string tmp() { return f("%t{}", t++); }
+
+    // --- Bigint temporaries ---
+    bool temps = false;  // the current statement took temporaries from the arena
+
+    // r = bi_<fn>_into(arena, args...)
+    std::string into(std::string_view fn, const std::string& args) {
+        auto r = tmp();
+        p("  {} = call ptr @bi_{}_into(ptr %bi.arena, {})\n", r, fn, args);
+        temps = true;
+        return r;
+    }
+
+    // Ends the statement's temporaries, if it made any
+    void reset() {
+        if (!temps) return;
+        temps = false;
+        p("  call void @bi_arena_reset(ptr %bi.arena)\n");
+    }
+
+    // Exchanges the allocas %x<sfx> and %y<sfx> of type ty: with each part of
+    // a variable, the move x := y (see mark_moves)
+    void swap(std::string_view x, std::string_view y, std::string_view sfx, std::string_view ty) {
+        auto xv = tmp(), yv = tmp();
+        p("  {} = load {}, ptr %{}{}\n  {} = load {}, ptr %{}{}\n", xv, ty, x, sfx, yv, ty, y, sfx);
+        p("  store {} {}, ptr %{}{}\n  store {} {}, ptr %{}{}\n", ty, yv, x, sfx, ty, xv, y, sfx);
+    }
+
+    std::string lit(int v) {
+        if (bi) return into("init", f("i64 {}", v));
+        return std::to_string(v);
+    }
+
+    std::string e(Node x) {
+        switch (a->kind(x)) {
+        case Kind::Num:
+            return lit(a->val(x));
+        case Kind::Var: {
+            auto r = tmp();
+            if (bi)
+                p("  {} = load ptr, ptr %{}\n", r, a->name(x).str);
+            else
+                p("  {} = load {}, ptr %{}\n", r, I, a->name(x).str);
+            return r;
+        }
+        case Kind::Neg: {
+            auto v = e(a->kid(x));
+            if (bi) return into("neg", f("ptr {}", v));
+            auto r = tmp();
+            p("  {} = sub {} 0, {}\n", r, I, v);
+            return r;
+        }
+        case Kind::Bin:
+            break;
+        default:
+            return bi ? "null" : "0";
+        }
+        // Bigint chains of + and - are one bi_sum over an array of
+        // {operand, subtracted} pairs
+        if (std::vector<Addend> terms; bi && sum_terms(*a, x, terms)) {
+            std::vector<std::string> vs;
+            for (auto [y, sub] : terms) vs.push_back(e(y));
+            auto ops = tmp();
+            p("  {} = call ptr @bi_arena_alloc(ptr %bi.arena, i32 {})\n", ops, 16 * terms.size());
+            for (size_t i = 0; i < terms.size(); ++i) {
+                auto pv = tmp(), ps = tmp();
+                p("  {} = getelementptr {{ptr, i8}}, ptr {}, i64 {}, i32 0\n", pv, ops, i);
+                p("  store ptr {}, ptr {}\n", vs[i], pv);
+                p("  {} = getelementptr {{ptr, i8}}, ptr {}, i64 {}, i32 1\n", ps, ops, i);
+                p("  store i8 {}, ptr {}\n", int(terms[i].sub), ps);
+            }
+            return into("sum", f("ptr {}, i32 {}", ops, terms.size()));
+        }
+        char op = a->op(x);
+        auto lv = e(a->lhs(x)), rv = e(a->rhs(x));
+        if (is_cmp(op)) {
+            auto pred = op == '=' ? "eq" : op == '!' ? "ne" : op == '<' ? "slt"
+                      : op == '>' ? "sgt" : op == 'l' ? "sle" : "sge";
+            auto c = tmp(), z = tmp();
+            if (bi) {
+                // bi_cmp gives -1/0/1; the 0/1 result is a literal temporary
+                auto r = tmp();
+                p("  {} = call i32 @bi_cmp(ptr {}, ptr {})\n", r, lv, rv);
+                p("  {} = icmp {} i32 {}, 0\n", c, pred, r);
+                p("  {} = zext i1 {} to i64\n", z, c);
+                return into("init", f("i64 {}", z));
+            }
+            p("  {} = icmp {} {} {}, {}\n", c, pred, I, lv, rv);
+            p("  {} = zext i1 {} to {}\n", z, c, I);
+            return z;
+        }
+        const char *fn = op == '+' ? "add" : op == '-' ? "sub" : op == '*' ? "mul" : op == '/' ? "div" : "mod";
+        if (!bi && (op == '/' || op == '%')) {
+            auto r = tmp();
+            p("  {} = call {} @e{}({} {}, {} {})\n", r, I, fn, I, lv, I, rv);
+            return r;
+        }
+        if (bi) return into(fn, f("ptr {}, ptr {}", lv, rv));
+        auto r = tmp();
+        p("  {} = {} {} {}, {}\n", r, fn, I, lv, rv);
+        return r;
+    }
+
+    // --- Hybrid integers (--hybrid) ---
+    // A variable x is %x (i64), %x.big (ptr, null while the value fits in
+    // int64) and %x.cap; the '.' keeps these apart from user names. Every
+    // operation runs in its own block: the int64 result when both operands
+    // are small and the overflow intrinsic reports no overflow, otherwise a
+    // cold call into the runtime, joined by phis. Promoted temporaries are
+    // released after the statement that made them.
+    struct HV { std::string v, b; };  // int64 value (or sign) and bigint pointer
+    bool hy_temps = false;            // the current statement may have promoted a temporary
+
+    std::string label() { return f("L{}", lbl++); }
+
+    // Starts a new block so its label can name a phi predecessor
+    std::string block() {
+        auto k = label();
+        p("  br label %{}\n{}:\n", k, k);
+        return k;
+    }
+
+    // i1 that is true when any operand is a bigint (literals never are)
+    std::string any_big(std::initializer_list<const HV *> xs) {
+        std::string r = "false";
+        for (auto *x : xs) {
+            if (x->b == "null") continue;
+            auto c = tmp();
+            p("  {} = icmp ne ptr {}, null\n", c, x->b);
+            if (r != "false") {
+                auto o = tmp();
+                p("  {} = or i1 {}, {}\n", o, r, c);
+                c = o;
+            }
+            r = c;
+        }
+        return r;
+    }
+
+    // Checked int64 op: {result, overflow}
+    std::pair<std::string, std::string> checked(const char* op, const std::string& a, const std::string& b) {
+        auto o = tmp(), r = tmp(), ov = tmp();
+        p("  {} = call {{i64, i1}} @llvm.s{}.with.overflow.i64(i64 {}, i64 {})\n", o, op, a, b);
+        p("  {} = extractvalue {{i64, i1}} {}, 0\n  {} = extractvalue {{i64, i1}} {}, 1\n", r, o, ov, o);
+        return {r, ov};
+    }
+
+    std::string either(const std::string& a, const std::string& b) {
+        auto r = tmp();
+        p("  {} = or i1 {}, {}\n", r, a, b);
+        return r;
+    }
+
+    HV load(std::string_view name) {
+        auto v = tmp(), b = tmp();
+        p("  {} = load i64, ptr %{}\n  {} = load ptr, ptr %{}.big\n", v, name, b, name);
+        return {v, b};
+    }
+
+    HV hybin(char op, const HV& a, const HV& b) {
+        if (is_cmp(op)) {
+            auto pred = op == '=' ? "eq" : op == '!' ? "ne" : op == '<' ? "slt"
+                      : op == '>' ? "sgt" : op == 'l' ? "sle" : "sge";
+            auto k = block(), slow = label(), z = label();
+            auto big = any_big({&a, &b});
+            auto c = tmp();
+            p("  {} = icmp {} i64 {}, {}\n", c, pred, a.v, b.v);
+            p("  br i1 {}, label %{}, label %{}, !prof !0\n{}:\n", big, slow, z, slow);
+            auto r = tmp(), cs = tmp();
+            p("  {} = call i32 @hy_cmp(i64 {}, ptr {}, i64 {}, ptr {})\n", r, a.v, a.b, b.v, b.b);
+            p("  {} = icmp {} i32 {}, 0\n  br label %{}\n{}:\n", cs, pred, r, z, z);
+            auto j = tmp(), v = tmp();
+            p("  {} = phi i1 [ {}, %{} ], [ {}, %{} ]\n", j, c, k, cs, slow);
+            p("  {} = zext i1 {} to i64\n", v, j);
+            return {v, "null"};
+        }
+        auto k = block(), slow = label(), z = label();
+        auto big = any_big({&a, &b});
+        std::string fast = k, r;
+        if (op == '/' || op == '%') {
+            // b = -1 is promoted too: INT64_MIN / -1 overflows
+            auto m1 = tmp();
+            p("  {} = icmp eq i64 {}, -1\n", m1, b.v);
+            fast = label();
+            p("  br i1 {}, label %{}, label %{}, !prof !0\n{}:\n", either(big, m1), slow, fast, fast);
+            r = tmp();
+            p("  {} = call i64 @e{}(i64 {}, i64 {})\n  br label %{}\n", r, op == '/' ? "div" : "mod", a.v, b.v, z);
+        } else {
+            auto [v, ov] = checked(op == '+' ? "add" : op == '-' ? "sub" : "mul", a.v, b.v);
+            r = v;
+            p("  br i1 {}, label %{}, label %{}, !prof !0\n", either(big, ov), slow, z);
+        }
+        auto sb = tmp(), sv = tmp();
+        p("{}:\n  {} = call ptr @hy_op(i32 {}, i64 {}, ptr {}, i64 {}, ptr {}, ptr %hy.out)\n", slow, sb, int(op), a.v, a.b, b.v, b.b);
+        p("  {} = load i64, ptr %hy.out\n  br label %{}\n{}:\n", sv, z, z);
+        hy_temps = true;
+        auto v = tmp(), bp = tmp();
+        p("  {} = phi i64 [ {}, %{} ], [ {}, %{} ]\n", v, r, fast, sv, slow);
+        p("  {} = phi ptr [ null, %{} ], [ {}, %{} ]\n", bp, fast, sb, slow);
+        return {v, bp};
+    }
+
+    HV h(Node x) {
+        switch (a->kind(x)) {
+        case Kind::Num:
+            return {std::to_string(a->val(x)), "null"};
+        case Kind::Var:
+            return load(a->name(x).str);
+        case Kind::Neg:
+            return hybin('-', {"0", "null"}, h(a->kid(x)));
+        case Kind::Bin: {
+            auto l = h(a->lhs(x));
+            return hybin(a->op(x), l, h(a->rhs(x)));
+        }
+        default:
+            return {"0", "null"};
+        }
+    }
+
+    // Frees the statement's promoted temporaries, if it made any
+    void release() {
+        if (!hy_temps) return;
+        hy_temps = false;
+        auto n = tmp(), c = tmp();
+        auto rel = label(), z = label();
+        p("  {} = load i32, ptr @hy_ntemps\n  {} = icmp ne i32 {}, 0\n", n, c, n);
+        p("  br i1 {}, label %{}, label %{}, !prof !0\n", c, rel, z);
+        p("{}:\n  call void @hy_release()\n  br label %{}\n{}:\n", rel, z, z);
+    }
+
+    // x := v: a store while both sides are int64
+    void hyassign(std::string_view x, const HV& v) {
+        auto xb = tmp();
+        p("  {} = load ptr, ptr %{}.big\n", xb, x);
+        HV old{"", xb};
+        auto slow = label(), fast = label(), z = label();
+        p("  br i1 {}, label %{}, label %{}, !prof !0\n", any_big({&old, &v}), slow, fast);
+        p("{}:\n  store i64 {}, ptr %{}\n  br label %{}\n", fast, v.v, x, z);
+        p("{}:\n  call void @hy_assign(ptr %{}, ptr %{}.big, ptr %{}.cap, i64 {}, ptr {})\n  br label %{}\n{}:\n",
+          slow, x, x, x, v.v, v.b, z, z);
+    }
+
+    // i1 for v == 0 (a bigint is never zero); releases temporaries first
+    std::string hyzero(Node x) {
+        auto v = h(x);
+        auto r = tmp();
+        p("  {} = icmp eq i64 {}, 0\n", r, v.v);
+        release();
+        return r;
+    }
+
+    // Hybrid statements; false for the kinds s() shares with other modes
+    bool hs(Node x) {
+        switch (a->kind(x)) {
+        case Kind::Assign: {
+            char op = 0;
+            Node d = self_update(*a, x, &op);
+            auto name = a->name(x).str;
+            if (a->op(x) == 'm') {
+                auto y = a->name(a->kid(x)).str;
+                swap(name, y, "", "i64");
+                swap(name, y, ".big", "ptr");
+                swap(name, y, ".cap", "i32");
+            } else if (d == NO_NODE) {
+                hyassign(name, h(a->kid(x)));
+            } else {
+                // x := x ± d in place
+                auto e = h(d);
+                auto xv = load(name);
+                auto [r, ov] = checked(op == '+' ? "add" : "sub", xv.v, e.v);
+                auto slow = label(), fast = label(), z = label();
+                p("  br i1 {}, label %{}, label %{}, !prof !0\n", either(any_big({&xv, &e}), ov), slow, fast);
+                p("{}:\n  store i64 {}, ptr %{}\n  br label %{}\n", fast, r, name, z);
+                p("{}:\n  call void @hy_update(i32 {}, ptr %{}, ptr %{}.big, ptr %{}.cap, i64 {}, ptr {})\n  br label %{}\n{}:\n",
+                  slow, int(op), name, name, name, e.v, e.b, z, z);
+            }
+            release();
+            return true;
+        }
+        case Kind::BreakIfz: {
+            auto r = hyzero(a->kid(x));
+            int n = lbl++;
+            p("  br i1 {}, label %{}, label %L{}\nL{}:\n", r, brk(), n, n);
+            return true;
+        }
+        case Kind::Print: {
+            auto v = h(a->kid(x));
+            p("  call void @hy_print(i64 {}, ptr {})\n", v.v, v.b);
+            release();
+            return true;
+        }
+        case Kind::MulAdd: {
+            // n < 0 (the sign is in %n for bigints too) runs the original loop
+            auto n = a->name(a->count(x)).str;
+            auto fast = label(), slow = label(), z = label();
+            auto nv = load(n);
+            auto r = tmp();
+            p("  {} = icmp slt i64 {}, 0\n", r, nv.v);
+            p("  br i1 {}, label %{}, label %{}\n{}:\n", r, slow, fast, fast);
+            if (a->acc(x) != NO_NODE) {
+                auto acc = a->name(a->acc(x)).str;
+                auto e = h(a->step(x));
+                auto av = load(acc);
+                auto [pv, ov1] = checked("mul", nv.v, e.v);
+                auto [rv, ov2] = checked(a->op(x) == '+' ? "add" : "sub", av.v, pv);
+                auto cold = label(), store = label(), done = label();
+                auto big = any_big({&nv, &e, &av});
+                p("  br i1 {}, label %{}, label %{}, !prof !0\n", either(big, either(ov1, ov2)), cold, store);
+                p("{}:\n  store i64 {}, ptr %{}\n  br label %{}\n", store, rv, acc, done);
+                p("{}:\n  call void @hy_mul_add(i32 {}, ptr %{}, ptr %{}.big, ptr %{}.cap, i64 {}, ptr {}, i64 {}, ptr {})\n  br label %{}\n{}:\n",
+                  cold, int(a->op(x)), acc, acc, acc, nv.v, nv.b, e.v, e.b, done, done);
+                release();
+            }
+            hyassign(n, {"0", "null"});
+            p("  br label %{}\n{}:\n", z, slow);
+            s(a->loop(x));
+            p("  br label %{}\n{}:\n", z, z);
+            return true;
+        }
+        default:
+            return false;
+        }
+    }
+
+    void s(Node x) {
+        if (hybrid && hs(x))
+            return;
+        switch (a->kind(x)) {
+        case Kind::Assign:
+            if (bi && a->op(x) == 'm') {
+                swap(a->name(x).str, a->name(a->kid(x)).str, "", "ptr");
+                swap(a->name(x).str, a->name(a->kid(x)).str, "_cap", "i32");
+            } else if (bi) {
+                // Self-updates `x := x ± e` go through the in-place kernels
+                char op = 0;
+                Node d = self_update(*a, x, &op);
+                const char *fn = d == NO_NODE ? "assign" : op == '+' ? "add_assign" : "sub_assign";
+                auto v = e(d != NO_NODE ? d : a->kid(x));
+                p("  call void @bi_{}(ptr %{}, ptr %{}_cap, ptr {})\n", fn, a->name(x).str, a->name(x).str, v);
+                reset();
+            } else {
+                auto v = e(a->kid(x));
+                p("  store {} {}, ptr %{}\n", I, v, a->name(x).str);
+            }
+            break;
+        case Kind::Block:
+            for (auto y : a->items(x)) s(y);
+            break;
+        case Kind::Loop: {
+            int h = lbl++, z = lbl++;
+            ex.push_back(z);
+            p("  br label %L{}\nL{}:\n", h, h);
+            s(a->kid(x));
+            p("  br label %L{}\nL{}:\n", h, z);
+            ex.pop_back();
+            break;
+        }
+        case Kind::BreakIfz: {
+            auto c = e(a->kid(x));
+            auto r = tmp();
+            int n = lbl++;
+            if (bi) {
+                p("  {} = call i1 @bi_is_zero(ptr {})\n", r, c);
+                reset();
+            } else
+                p("  {} = icmp eq {} {}, 0\n", r, I, c);
+            p("  br i1 {}, label %{}, label %L{}\nL{}:\n", r, brk(), n, n);
+            break;
+        }
+        case Kind::Print: {
+            auto v = e(a->kid(x));
+            if (bi) {
+                p("  call void @bi_print(ptr {})\n", v);
+                reset();
+            } else
+                p("  call void @print_int({} {})\n", I, v);
+            break;
+        }
+        case Kind::Break: {
+            int n = lbl++;
+            p("  br label %{}\nL{}:\n", brk(), n);
+            break;
+        }
+        case Kind::Case: {
+            // Guard i branches to its arm or on to guard i + 1; arms join at z.
+            // Guard temporaries are released before branching.
+            int z = lbl++;
+            for (auto arm : a->items(x)) {
+                int body = lbl++, next = lbl++;
+                if (hybrid) {
+                    p("  br i1 {}, label %L{}, label %L{}\nL{}:\n", hyzero(a->guard(arm)), next, body, body);
+                    s(a->kid(arm));
+                    p("  br label %L{}\nL{}:\n", z, next);
+                    continue;
+                }
+                auto v = e(a->guard(arm));
+                auto r = tmp();
+                if (bi) {
+                    p("  {} = call i1 @bi_is_zero(ptr {})\n", r, v);
+                    reset();
+                } else
+                    p("  {} = icmp eq {} {}, 0\n", r, I, v);
+                p("  br i1 {}, label %L{}, label %L{}\nL{}:\n", r, next, body, body);
+                s(a->kid(arm));
+                p("  br label %L{}\nL{}:\n", z, next);
+            }
+            p("  br label %L{}\nL{}:\n", z, z);
+            break;
+        }
+        case Kind::MulAdd: {
+            // n < 0 runs the original loop; otherwise acc ±= n * e, n := 0
+            auto n = a->name(a->count(x)).str;
+            int fast = lbl++, slow = lbl++, z = lbl++;
+            auto nv = tmp(), r = tmp();
+            if (bi) {
+                p("  {} = load ptr, ptr %{}\n", nv, n);
+                p("  {} = call i1 @bi_is_neg(ptr {})\n", r, nv);
+            } else {
+                p("  {} = load {}, ptr %{}\n", nv, I, n);
+                p("  {} = icmp slt {} {}, 0\n", r, I, nv);
+            }
+            p("  br i1 {}, label %L{}, label %L{}\nL{}:\n", r, slow, fast, fast);
+            bool acc = a->acc(x) != NO_NODE;
+            auto an = acc ? a->name(a->acc(x)).str : std::string_view();
+            const char *op = a->op(x) == '+' ? "add" : "sub";
+            if (bi) {
+                if (acc) {
+                    auto v = e(a->step(x));
+                    p("  call void @bi_mul_{}_assign(ptr %{}, ptr %{}_cap, ptr {}, ptr {})\n", op, an, an, nv, v);
+                }
+                auto zv = lit(0);
+                p("  call void @bi_assign(ptr %{}, ptr %{}_cap, ptr {})\n", n, n, zv);
+                reset();
+            } else {
+                if (acc) {
+                    auto v = e(a->step(x)), av = tmp(), pv = tmp(), rv = tmp();
+                    p("  {} = load {}, ptr %{}\n", av, I, an);
+                    p("  {} = mul {} {}, {}\n", pv, I, nv, v);
+                    p("  {} = {} {} {}, {}\n", rv, op, I, av, pv);
+                    p("  store {} {}, ptr %{}\n", I, rv, an);
+                }
+                p("  store {} 0, ptr %{}\n", I, n);
+            }
+            p("  br label %L{}\nL{}:\n", z, slow);
+            s(a->loop(x));
+            p("  br label %L{}\nL{}:\n", z, z);
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    void gen(Ast &prog) {
+        auto syms = resolve(prog);
+        a = &prog;
+        std::vector<std::string> vars;  // user variables in slot order (excludes argN)
+        for (size_t i = ARG_COUNT; i < syms.size(); ++i)
+            vars.push_back(syms[i].name);
+        if (hybrid) {
+            p("{}\n", llvm_hybrid_preamble());
+            for (auto &v : vars)
+                p("  %{0} = alloca i64\n  store i64 0, ptr %{0}\n  %{0}.big = alloca ptr\n  store ptr null, ptr %{0}.big\n"
+                  "  %{0}.cap = alloca i32\n  store i32 0, ptr %{0}.cap\n", v);
+            emit_args_llvm_hybrid();
+        } else if (bi) {
+            p("{}\n", LLVM_BIGINT_PREAMBLE);
+            p("  %bi.arena = call ptr @bi_arena_new()\n");
+            for (auto &v : vars) {
+                p("  %{} = alloca ptr\n", v);
+                p("  %{}_cap = alloca i32\n", v);
+                p("  call void @bi_var_init(ptr %{}, ptr %{}_cap)\n", v, v);
+            }
+            emit_args_llvm_bigint();
+        } else {
+            p("{}", llvm_int_preamble(I));
+            for (auto &v : vars)
+                p("  %{} = alloca {}\n  store {} 0, ptr %{}\n", v, I, I, v);
+            emit_args_llvm_int(I);
+        }
+        if (unbuffered)
+            p("  call void @out_unbuffered()\n");
+        s(prog.root);
+        if (orphan)
+            p("  br label %Lend\nLend:\n");
+        if (bi && !hybrid)
+            p("  call void @bi_arena_free(ptr %bi.arena)\n");
+        p("  call void @out_flush()\n  ret i32 0\n}}\n");
+        if (hybrid)
+            p("\n!0 = !{{!\"branch_weights\", i32 1, i32 2000}}\n");
+    }
+};
+
+// Generator output as a string instead of on gen_out (e1 --jit, the cache in
+// e1_compile)
+inline std::string gen_string(auto gen, Ast &prog) {
+    char *buf = nullptr;
+    size_t len = 0;
+    FILE *mem = open_memstream(&buf, &len);
+    auto *saved = std::exchange(gen_out, mem);
+    gen.gen(prog);
+    gen_out = saved;
+    std::fclose(mem);
+    std::string text(buf, len);
+    std::free(buf);
+    return text;
+}
@@ -0,0 +1,240 @@
+// PL/0 Levels 1-2 — Hybrid integers: native int64 with bigint promotion
+//
+// Used by `e1_compile --hybrid` (both backends, bigint builds only). Every
+// value is an int64_t until an operation overflows it; the overflow check is
+// the only cost on the fast path, and the promotion path is cold code that
+// computes the exact result with the bigint kernels. Results match the
+// bigint build exactly.
+//
+// A value is a pair (v, big): with big.ptr null the value is v; otherwise it
+// is *big.ptr, and v holds its sign (1 or -1), so zero and sign tests read v
+// alone. Values are kept canonical: a bigint result that fits in int64 is
+// demoted back to v and its buffer freed, so big.ptr set means |value| does
+// not fit in 64 bits.
+//
+// The C++ backend uses Num (RAII, through the E1_HYBRID macros in
+// e1_preamble.hpp); the LLVM backend keeps (v, ptr, cap) in allocas and calls
+// the hy_* wrappers in e1_rt_bigint.cpp, which use the functions below.
+#pragma once
+#include "e1_bigint.hpp"
+#include <utility>
+
+namespace hybrid {
+
+using bigint::Limb;
+using bigint::Raw;
+using bigint::Size;
+using bigint::Var;
+
+static_assert(LIMB_BITS >= 64, "hybrid integers view an int64 as one limb");
+
+// --- Conversions ---
+
+// *big, or v in the one-limb buffer `buf` (INT64_MIN needs no negation)
+inline const Raw& view(int64_t v, const Raw* big, Raw& buf) {
+    if (big) return *big;
+    uint64_t m = v < 0 ? 0 - uint64_t(v) : uint64_t(v);
+    buf.neg = v < 0;
+    buf.limbs[0] = m;
+    buf.size = m != 0;
+    return buf;
+}
+
+// r as an int64, if it fits
+inline bool fits(const Raw& r, int64_t& out) {
+    if (r.size == 0) return out = 0, true;
+    if (r.size > 1 || r.limbs[0] > Limb(uint64_t(INT64_MAX) + r.neg)) return false;
+    auto m = uint64_t(r.limbs[0]);
+    out = r.neg ? int64_t(0 - m) : int64_t(m);
+    return true;
+}
+
+inline void drop(Var& big) {
+    std::free(big.ptr);
+    big = {};
+}
+
+// Canonical form after big has been written in place
+inline void settle(int64_t& v, Var& big) {
+    if (fits(*big.ptr, v)) drop(big);
+    else v = big.ptr->neg ? -1 : 1;
+}
+
+// (v, big) := r; r may be *big.ptr
+inline void store(int64_t& v, Var& big, const Raw& r) {
+    if (&r != big.ptr) {
+        int64_t s;
+        if (fits(r, s)) return v = s, drop(big);
+        bigint::assign(big, r);
+    }
+    settle(v, big);
+}
+
+// --- Promotion paths (exact, via the bigint kernels) ---
+
+// (v, big) := a o b for o in + - * / %; big must not hold a or b
+[[gnu::cold]] inline void op(char o, int64_t& v, Var& big, int64_t av, const Raw* ab, int64_t bv, const Raw* bb) {
+    BIGINT_LIT(la);
+    BIGINT_LIT(lb);
+    const Raw &a = view(av, ab, la), &b = view(bv, bb, lb);
+    Size n = o == '+' ? bigint::add_size(a, b) : o == '-' ? bigint::sub_size(a, b)
+           : o == '*' ? bigint::mul_size(a, b) : o == '/' ? bigint::div_size(a, b) : bigint::mod_size(a, b);
+    BIGINT_TMP(r, n);
+    switch (o) {
+    case '+': bigint::add(r, a, b); break;
+    case '-': bigint::sub(r, a, b); break;
+    case '*': bigint::mul(r, a, b); break;
+    case '/': bigint::divmod(&r, nullptr, a, b); break;
+    default: bigint::divmod(nullptr, &r, a, b); break;
+    }
+    store(v, big, r);
+}
+
+[[gnu::cold]] inline int cmp(int64_t av, const Raw* ab, int64_t bv, const Raw* bb) {
+    BIGINT_LIT(la);
+    BIGINT_LIT(lb);
+    return bigint::cmp(view(av, ab, la), view(bv, bb, lb));
+}
+
+// x := x ± b in place (the add_assign kernels once x is a bigint)
+[[gnu::cold]] inline void update(char o, int64_t& v, Var& big, int64_t bv, const Raw* bb) {
+    if (!big.ptr) return op(o, v, big, v, nullptr, bv, bb);
+    BIGINT_LIT(lb);
+    const Raw& b = view(bv, bb, lb);
+    o == '+' ? bigint::add_assign(big, b) : bigint::sub_assign(big, b);
+    settle(v, big);
+}
+
+// x := x ± n * e (Kind::MulAdd); n and e must not be x
+[[gnu::cold]] inline void mul_add(bool sub, int64_t& v, Var& big, int64_t nv, const Raw* nb, int64_t ev, const Raw* eb) {
+    BIGINT_LIT(lx);
+    BIGINT_LIT(ln);
+    BIGINT_LIT(le);
+    if (!big.ptr) bigint::assign(big, view(v, nullptr, lx));
+    bigint::mul_add_assign(big, view(nv, nb, ln), view(ev, eb, le), sub);
+    settle(v, big);
+}
+
+// x := (sv, sb); sb may be x's own buffer
+inline void assign(int64_t& v, Var& big, int64_t sv, const Raw* sb) {
+    if (sb) store(v, big, *sb);
+    else v = sv, drop(big);
+}
+
+inline void print(int64_t v, const Raw* big) {
+    if (big) bigint::print(*big);
+    else out::line(v);
+}
+
+inline void arg_init(int64_t& v, Var& big, int argc, char** argv, int idx) {
+    auto a = bigint::arg_init(argc, argv, idx);
+    big = {};
+    store(v, big, *a.ptr);
+    std::free(a.ptr);
+}
+
+// --- int64 fast paths ---
+
+// e2 division is Euclidean, with x / 0 = x % 0 = 0. Callers route b = -1
+// (INT64_MIN / -1 overflows) to the promotion path.
+inline int64_t ediv(int64_t a, int64_t b) {
+    if (b == 0) return 0;
+    int64_t q = a / b;
+    return a % b < 0 ? q + (b > 0 ? -1 : 1) : q;
+}
+inline int64_t emod(int64_t a, int64_t b) {
+    if (b == 0) return 0;
+    int64_t r = a % b;
+    return r < 0 ? r + (b > 0 ? b : -b) : r;
+}
+
+// One hybrid value for generated C++; temporaries free their bigint on
+// scope exit
+struct Num {
+    int64_t v = 0;
+    Var big = {};  // big.ptr set: the value is *big.ptr, v its sign
+
+    Num() = default;
+    Num(int64_t x) : v(x) {}
+    Num(const Num& o) : v(o.v) {
+        if (o.big.ptr) bigint::assign(big, *o.big.ptr);
+    }
+    Num(Num&& o) noexcept : v(o.v), big(std::exchange(o.big, {})) {}
+    Num& operator=(const Num& o) {
+        if (!big.ptr && !o.big.ptr) [[likely]] v = o.v;
+        else assign(v, big, o.v, o.big.ptr);
+        return *this;
+    }
+    ~Num() {
+        if (big.ptr) [[unlikely]] std::free(big.ptr);
+    }
+    friend void swap(Num& a, Num& b) noexcept {
+        std::swap(a.v, b.v);
+        std::swap(a.big, b.big);
+    }
+
+    bool small() const { return !big.ptr; }
+};
+
+template <char O> [[gnu::cold, gnu::noinline]] Num binop_slow(const Num& a, const Num& b) {
+    Num r;
+    op(O, r.v, r.big, a.v, a.big.ptr, b.v, b.big.ptr);
+    return r;
+}
+
+template <char O> inline Num binop(const Num& a, const Num& b) {
+    if (a.small() && b.small()) [[likely]] {
+        int64_t r;
+        if constexpr (O == '+') {
+            if (!__builtin_add_overflow(a.v, b.v, &r)) [[likely]] return r;
+        } else if constexpr (O == '-') {
+            if (!__builtin_sub_overflow(a.v, b.v, &r)) [[likely]] return r;
+        } else if constexpr (O == '*') {
+            if (!__builtin_mul_overflow(a.v, b.v, &r)) [[likely]] return r;
+        } else if (b.v != -1) [[likely]] {
+            return O == '/' ? ediv(a.v, b.v) : emod(a.v, b.v);
+        }
+    }
+    return binop_slow<O>(a, b);
+}
+
+inline int compare(const Num& a, const Num& b) {
+    if (a.small() && b.small()) [[likely]] return (a.v > b.v) - (a.v < b.v);
+    return cmp(a.v, a.big.ptr, b.v, b.big.ptr);
+}
+
+template <char O> [[gnu::cold, gnu::noinline]] void update_slow(Num& x, const Num& b) {
+    update(O, x.v, x.big, b.v, b.big.ptr);
+}
+
+template <char O> inline void update(Num& x, const Num& b) {
+    int64_t r;
+    if (x.small() && b.small() &&
+        !(O == '+' ? __builtin_add_overflow(x.v, b.v, &r) : __builtin_sub_overflow(x.v, b.v, &r))) [[likely]]
+        x.v = r;
+    else
+        update_slow<O>(x, b);
+}
+
+[[gnu::cold, gnu::noinline]] inline void mul_add_slow(Num& x, const Num& n, const Num& e, bool sub) {
+    mul_add(sub, x.v, x.big, n.v, n.big.ptr, e.v, e.big.ptr);
+}
+
+inline void mul_add(Num& x, const Num& n, const Num& e, bool sub) {
+    int64_t p, r;
+    if (x.small() && n.small() && e.small() && !__builtin_mul_overflow(n.v, e.v, &p) &&
+        !(sub ? __builtin_sub_overflow(x.v, p, &r) : __builtin_add_overflow(x.v, p, &r))) [[likely]]
+        x.v = r;
+    else
+        mul_add_slow(x, n, e, sub);
+}
+
+inline void print(const Num& x) { print(x.v, x.big.ptr); }
+
+inline Num arg(int argc, char** argv, int idx) {
+    Num x;
+    arg_init(x.v, x.big, argc, argv, idx);
+    return x;
+}
+
+} // namespace hybrid
@@ -0,0 +1,228 @@
+// PL/0 Levels 1-2 — In-process LLVM JIT (e1 --jit; //src:e1_jit, //src:e2_jit)
+//
+// Runs a program through the LLVM backend without leaving the process:
+//   1. GenLLVM (e1_gen.hpp) writes the IR into memory
+//   2. it is parsed and linked with the runtime IR, e1_rt_bigint.ll, which the
+//      build embeds as E1_RT_IR (//src:e1_rt_ir_hpp)
+//   3. everything but main is internalized, so the pass pipeline inlines the
+//      runtime and drops what the program does not use
+//   4. the module is optimized with a new-pass-manager pipeline
+//      (--jit-passes=..., default "default<O3>") for the host CPU
+//   5. ORC LLJIT compiles it and main() runs in this process
+// This is the same code the e1_llvm_binary genrule produces, minus the
+// llvm-link/clang processes and the files between them. --jit-stats reports
+// the compile time (steps 1-5 up to the address of main) and the run time on
+// stderr.
+//
+// With $E1_CACHE_DIR set (e1_cache.hpp), a run stores the optimized module as
+// bitcode and the object code generated for it, keyed by source, flags,
+// passes and host CPU. A warm start reads the bitcode back instead of steps
+// 1-4, and codegen is answered from the cached object (ObjectStore). The
+// module is still added as IR so that LLJIT runs the runtime's static
+// constructors as before.
+#pragma once
+#include "e1_cache.hpp"
+#include "e1_gen.hpp"
+#include "src/e1_rt_ir.hpp"
+#include <chrono>
+#include <llvm/AsmParser/Parser.h>
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/ExecutionEngine/ObjectCache.h>
+#include <llvm/ExecutionEngine/Orc/AbsoluteSymbols.h>
+#include <llvm/ExecutionEngine/Orc/CompileUtils.h>
+#include <llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h>
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Linker/Linker.h>
+#include <llvm/Passes/PassBuilder.h>
+#include <llvm/Support/SourceMgr.h>
+#include <llvm/Support/TargetSelect.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Target/TargetMachine.h>
+#include <llvm/Transforms/IPO/Internalize.h>
+
+// compiler-rt helpers the runtime IR calls for DLimb (128-bit) division; a
+// static binary does not export them to the JIT's process symbol lookup
+extern "C" {
+unsigned __int128 __udivti3(unsigned __int128, unsigned __int128);
+unsigned __int128 __umodti3(unsigned __int128, unsigned __int128);
+__int128 __divti3(__int128, __int128);
+__int128 __modti3(__int128, __int128);
+}
+
+namespace jit {
+
+struct Options {
+    std::string passes = "default<O3>";
+    bool unbuffered = false;
+    bool stats = false;
+};
+
+using Clock = std::chrono::steady_clock;
+
+inline double ms_since(Clock::time_point t0) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+}
+
+inline std::expected<std::unique_ptr<llvm::Module>, std::string>
+parse_ir(llvm::StringRef ir, llvm::StringRef name, llvm::LLVMContext& ctx) {
+    llvm::SMDiagnostic diag;
+    auto m = llvm::parseAssemblyString(ir, diag, ctx);
+    if (!m) return std::unexpected(std::format("{}:{}: {}", name.str(), diag.getLineNo(), diag.getMessage().str()));
+    return m;
+}
+
+inline llvm::Error optimize(llvm::Module& m, llvm::TargetMachine& tm, const std::string& passes) {
+    llvm::LoopAnalysisManager lam;
+    llvm::FunctionAnalysisManager fam;
+    llvm::CGSCCAnalysisManager cgam;
+    llvm::ModuleAnalysisManager mam;
+    llvm::PassBuilder pb(&tm);
+    pb.registerModuleAnalyses(mam);
+    pb.registerCGSCCAnalyses(cgam);
+    pb.registerFunctionAnalyses(fam);
+    pb.registerLoopAnalyses(lam);
+    pb.crossRegisterProxies(lam, fam, cgam, mam);
+    llvm::ModulePassManager mpm;
+    if (auto err = pb.parsePassPipeline(mpm, passes)) return err;
+    mpm.run(m, mam);
+    return llvm::Error::success();
+}
+
+// Defines the compiler-rt helpers in the JIT's main dylib
+inline llvm::Error define_builtins(llvm::orc::LLJIT& j) {
+    llvm::orc::SymbolMap syms;
+    auto def = [&](const char* name, auto* fn) {
+        syms[j.mangleAndIntern(name)] = {llvm::orc::ExecutorAddr::fromPtr(fn), llvm::JITSymbolFlags::Exported};
+    };
+    def("__udivti3", &__udivti3);
+    def("__umodti3", &__umodti3);
+    def("__divti3", &__divti3);
+    def("__modti3", &__modti3);
+    return j.getMainJITDylib().define(llvm::orc::absoluteSymbols(std::move(syms)));
+}
+
+// Name of the program's module; the platform's own modules are not cached
+constexpr const char* ModuleName = "e1";
+
+// Object cache for the program's module: serves `cached` on a hit, keeps
+// what codegen produced in `compiled` on a miss
+struct ObjectStore : llvm::ObjectCache {
+    std::string_view cached;
+    std::string compiled;
+
+    void notifyObjectCompiled(const llvm::Module* m, llvm::MemoryBufferRef obj) override {
+        if (m->getModuleIdentifier() == ModuleName) compiled = obj.getBuffer().str();
+    }
+    std::unique_ptr<llvm::MemoryBuffer> getObject(const llvm::Module* m) override {
+        if (cached.empty() || m->getModuleIdentifier() != ModuleName) return nullptr;
+        return llvm::MemoryBuffer::getMemBuffer(llvm::StringRef(cached.data(), cached.size()), ModuleName, false);
+    }
+};
+
+// The program's module (steps 1-4): generated, linked with the runtime,
+// internalized and optimized
+inline std::expected<std::unique_ptr<llvm::Module>, std::string>
+build(std::string_view src, bool ast_opt, llvm::TargetMachine& tm, const Options& opt, llvm::LLVMContext& ctx) {
+    cache::Entry entry;
+    auto prog = cache::program(src, ast_opt, entry);
+    if (!prog) return std::unexpected(prog.error());
+    auto m = parse_ir(gen_string(GenLLVM{opt.unbuffered}, *prog), "program", ctx);
+    if (!m) return m;
+    auto rt = parse_ir(E1_RT_IR, "e1_rt_bigint.ll", ctx);
+    if (!rt) return rt;
+    auto& mod = **m;
+    mod.setDataLayout(tm.createDataLayout());
+    mod.setTargetTriple(tm.getTargetTriple());
+    (*rt)->setDataLayout(mod.getDataLayout());
+    (*rt)->setTargetTriple(mod.getTargetTriple());
+    if (llvm::Linker::linkModules(mod, std::move(*rt))) return std::unexpected("cannot link the runtime IR");
+    llvm::internalizeModule(mod, [](const llvm::GlobalValue& gv) { return gv.getName() == "main"; });
+    if (auto err = optimize(mod, tm, opt.passes)) return std::unexpected(llvm::toString(std::move(err)));
+    return m;
+}
+
+// Compiles and runs the program in src (optimized by e1_opt.hpp unless
+// !optimize); args is <file> [arg1..argN] as for the engines. Returns main's
+// exit status, or 1 after printing an error.
+inline int run(std::string_view src, bool optimize, const std::vector<char*>& args, const Options& opt) {
+    auto fail = [](const std::string& msg) {
+        std::println(stderr, "Error: jit: {}", msg);
+        return 1;
+    };
+    auto t0 = Clock::now();
+    llvm::InitializeNativeTarget();
+    llvm::InitializeNativeTargetAsmPrinter();
+    llvm::InitializeNativeTargetAsmParser();
+
+    auto jtmb = llvm::orc::JITTargetMachineBuilder::detectHost();
+    if (!jtmb) return fail(llvm::toString(jtmb.takeError()));
+    jtmb->setCodeGenOptLevel(llvm::CodeGenOptLevel::Aggressive);
+    auto tm = jtmb->createTargetMachine();
+    if (!tm) return fail(llvm::toString(tm.takeError()));
+
+    auto ctx = std::make_unique<llvm::LLVMContext>();
+    std::unique_ptr<llvm::Module> mod;
+    ObjectStore objects;
+    std::optional<cache::Key> key;
+    std::optional<cache::Entry> hit;
+    if (cache::dir()) {
+        key = cache::key(src, std::format("jit -O{} passes={} unbuffered={} cpu={} features={}", int(optimize),
+                                          opt.passes, opt.unbuffered, jtmb->getCPU(),
+                                          jtmb->getFeatures().getString()));
+        hit = cache::load(*key, 2);
+    }
+    std::string bitcode;
+    if (hit) {
+        auto bc = hit->sections[0];
+        auto m = llvm::parseBitcodeFile(llvm::MemoryBufferRef(llvm::StringRef(bc.data(), bc.size()), ModuleName),
+                                        *ctx);
+        if (!m) return fail(llvm::toString(m.takeError()));
+        mod = std::move(*m);
+        objects.cached = hit->sections[1];
+    } else {
+        auto m = build(src, optimize, **tm, opt, *ctx);
+        if (!m) return fail(m.error());
+        mod = std::move(*m);
+        if (key) {
+            llvm::raw_string_ostream os(bitcode);
+            llvm::WriteBitcodeToFile(*mod, os);
+        }
+    }
+    mod->setModuleIdentifier(ModuleName);
+
+    auto j = llvm::orc::LLJITBuilder()
+                 .setJITTargetMachineBuilder(std::move(*jtmb))
+                 .setCompileFunctionCreator([&](llvm::orc::JITTargetMachineBuilder b)
+                                                -> llvm::Expected<std::unique_ptr<llvm::orc::IRCompileLayer::IRCompiler>> {
+                     auto ctm = b.createTargetMachine();
+                     if (!ctm) return ctm.takeError();
+                     return std::make_unique<llvm::orc::TMOwningSimpleCompiler>(std::move(*ctm), &objects);
+                 })
+                 .create();
+    if (!j) return fail(llvm::toString(j.takeError()));
+    if (auto err = define_builtins(**j)) return fail(llvm::toString(std::move(err)));
+    if (auto err = (*j)->addIRModule(llvm::orc::ThreadSafeModule(std::move(mod), std::move(ctx))))
+        return fail(llvm::toString(std::move(err)));
+    auto sym = (*j)->lookup("main");  // materializes: codegen (or the cached object) happens here
+    if (!sym) return fail(llvm::toString(sym.takeError()));
+    auto* main_fn = sym->toPtr<int(int, char**)>();
+    if (key && !hit && !objects.compiled.empty()) cache::store(*key, {bitcode, objects.compiled});
+    double compile_ms = ms_since(t0);
+
+    // Static constructors run first; destructors and atexit handlers the
+    // runtime registered run before the JIT's memory goes away
+    std::vector<char*> argv(args);
+    argv.push_back(nullptr);
+    auto t1 = Clock::now();
+    if (auto err = (*j)->initialize((*j)->getMainJITDylib())) return fail(llvm::toString(std::move(err)));
+    int rc = main_fn(int(args.size()), argv.data());
+    if (auto err = (*j)->deinitialize((*j)->getMainJITDylib())) return fail(llvm::toString(std::move(err)));
+    if (opt.stats)
+        std::println(stderr, "jit: compile {:.3f} ms, run {:.3f} ms", compile_ms, ms_since(t1));
+    return rc;
+}
+
+} // namespace jit
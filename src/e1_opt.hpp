@@ -0,0 +1,365 @@
+// PL/0 Levels 1-2 — AST optimizer (C++23)
+//
+// Runs on the parsed program before resolve(), so every engine and backend
+// sees the same optimized tree (-O1, the default; -O0 skips it):
+//
+//   1. Forward pass: constant and copy propagation with constant folding.
+//      Facts `x = literal` / `x = y` flow through straight-line code; a loop
+//      kills the facts of every variable it assigns before its body is
+//      visited (back edge), a case keeps only facts no arm disturbs. Every
+//      variable other than arg1..argN starts as the fact `x = 0`. Folded
+//      values must fit a Num literal (and a narrow _BitInt), otherwise the
+//      expression is left alone, so bigint results stay exact.
+//      break_ifz on a constant becomes a break or disappears, case arms with
+//      constant guards are dropped or taken, code after a break is cut, and
+//      assignments that folded to `x := x` are removed.
+//   2. Backward pass: dead-store elimination by liveness. Expressions have
+//      no side effects (e2 x / 0 is 0, not an error), so an assignment whose
+//      value is never read is simply removed. Loops iterate to a fixpoint.
+//   3. Loop idioms: a counted accumulation
+//        loop { break_ifz n  acc := acc ± e  n := n - 1 }
+//      (the two assignments in either order, e reading neither acc nor n)
+//      becomes a MulAdd node, one multiply-add instead of n additions; so does
+//      the bare countdown left behind when acc is dead. The loop is kept for
+//      a negative n, which never reaches zero.
+#pragma once
+#include "e1.hpp"
+#include <climits>
+#include <optional>
+#include <unordered_set>
+
+namespace opt {
+
+using Names = std::unordered_set<uint32_t>;  // interned identifier ids
+
+// Rewrites happen in place (Ast::set, Ast::replace), so a node keeps its
+// index and its parent needs no update. A removed statement becomes an empty
+// Block, which compact() then drops from its list.
+
+// ---------- Helpers ----------
+
+// A folded value must fit a Num literal and, for INT_BITS < 32, the integer type
+inline bool fits(long long v) {
+    constexpr int B = INT_BITS > 0 && INT_BITS < 32 ? INT_BITS : 32;
+    constexpr long long lim = 1LL << (B - 1);
+    return v >= -lim && v < lim;
+}
+
+inline std::optional<long long> lit_of(const Ast& a, Node e) {
+    if (a.kind(e) == Kind::Num) return a.val(e);
+    return std::nullopt;
+}
+
+inline void set_lit(Ast& a, Node e, long long v) { a.set(e, Kind::Num, uint32_t(int(v))); }
+
+inline bool is_var(const Ast& a, Node e, uint32_t id) { return a.kind(e) == Kind::Var && a.id(e) == id; }
+
+inline bool same_var(const Ast& a, Node x, Node y) { return a.kind(x) == Kind::Var && is_var(a, y, a.id(x)); }
+
+// e2 semantics, see ediv/emod in e1.hpp
+inline long long fold_op(char op, long long a, long long b) {
+    long long r = b < 0 ? -b : b;
+    switch (op) {
+        case '+': return a + b;
+        case '-': return a - b;
+        case '*': return a * b;
+        case '/': return !b ? 0 : a / b - (a % b < 0 ? (b > 0 ? 1 : -1) : 0);
+        case '%': return !b ? 0 : a % b + (a % b < 0 ? r : 0);
+        case '=': return a == b;
+        case '!': return a != b;
+        case '<': return a < b;
+        case '>': return a > b;
+        case 'l': return a <= b;
+        case 'g': return a >= b;
+    }
+    return 0;
+}
+
+inline void uses(const Ast& a, Node x, Names& out) {
+    switch (a.kind(x)) {
+    case Kind::Var: out.insert(a.id(x)); break;
+    case Kind::Neg: uses(a, a.kid(x), out); break;
+    case Kind::Bin: uses(a, a.lhs(x), out); uses(a, a.rhs(x), out); break;
+    default: break;
+    }
+}
+
+// Variables assigned anywhere in x
+inline void assigned(const Ast& a, Node x, Names& out) {
+    switch (a.kind(x)) {
+    case Kind::Assign: out.insert(a.id(x)); break;
+    case Kind::Block: case Kind::Case: for (auto s : a.items(x)) assigned(a, s, out); break;
+    case Kind::Loop: case Kind::Arm: assigned(a, a.kid(x), out); break;
+    default: break;
+    }
+}
+
+// Every variable mentioned in x
+inline void names(const Ast& a, Node x, Names& out) {
+    switch (a.kind(x)) {
+    case Kind::Assign: out.insert(a.id(x)); uses(a, a.kid(x), out); break;
+    case Kind::Decl: out.insert(a.id(x)); break;
+    case Kind::Block: case Kind::Case: for (auto s : a.items(x)) names(a, s, out); break;
+    case Kind::Loop: names(a, a.kid(x), out); break;
+    case Kind::BreakIfz: case Kind::Print: uses(a, a.kid(x), out); break;
+    case Kind::Arm: uses(a, a.guard(x), out); names(a, a.kid(x), out); break;
+    default: break;
+    }
+}
+
+// True if control never falls through x (it always breaks)
+inline bool breaks(const Ast& a, Node x) {
+    if (a.kind(x) == Kind::Break) return true;
+    if (a.kind(x) == Kind::Block)
+        for (auto s : a.items(x))
+            if (breaks(a, s)) return true;
+    return false;
+}
+
+inline void remove(Ast& a, Node s) { a.set(s, Kind::Block); }
+inline bool removed(const Ast& a, Node s) { return a.kind(s) == Kind::Block && a.items(s).empty(); }
+
+// Drops removed statements from a Block
+inline void compact(Ast& a, Node block) {
+    auto items = a.items(block);
+    auto gone = std::ranges::remove_if(items, [&](Node s) { return removed(a, s); });
+    a.shrink(block, items.size() - gone.size());
+}
+
+// ---------- Forward: propagation and folding ----------
+
+// Known value of a variable: a literal or a copy of another variable
+struct Fact { std::optional<long long> lit; uint32_t var = 0; };
+using Facts = std::unordered_map<uint32_t, Fact>;  // by identifier id
+
+inline void kill(Facts& f, uint32_t id) {
+    f.erase(id);
+    std::erase_if(f, [&](auto& kv) { return !kv.second.lit && kv.second.var == id; });
+}
+
+inline void fold(Ast& a, Node e, const Facts& f) {
+    switch (a.kind(e)) {
+    case Kind::Var: {
+        auto it = f.find(a.id(e));
+        if (it == f.end()) return;
+        if (it->second.lit) set_lit(a, e, *it->second.lit);
+        else a.set(e, Kind::Var, it->second.var);
+        break;
+    }
+    case Kind::Neg: {
+        Node u = a.kid(e);
+        fold(a, u, f);
+        if (auto x = lit_of(a, u); x && fits(-*x)) set_lit(a, e, -*x);
+        else if (a.kind(u) == Kind::Neg) a.replace(e, a.kid(u));
+        break;
+    }
+    case Kind::Bin: {
+        Node l = a.lhs(e), r = a.rhs(e);
+        char op = a.op(e);
+        fold(a, l, f);
+        fold(a, r, f);
+        auto x = lit_of(a, l), y = lit_of(a, r);
+        if (x && y) {
+            if (auto v = fold_op(op, *x, *y); fits(v)) set_lit(a, e, v);
+        } else if (y == 0 && (op == '+' || op == '-')) a.replace(e, l);
+        else if (x == 0 && op == '+') a.replace(e, r);
+        else if (y == 1 && (op == '*' || op == '/')) a.replace(e, l);
+        else if (x == 1 && op == '*') a.replace(e, r);
+        else if ((x == 0 || y == 0) && op == '*') set_lit(a, e, 0);
+        else if (same_var(a, l, r) && (op == '-' || op == '%')) set_lit(a, e, 0);
+        break;
+    }
+    default: break;
+    }
+}
+
+inline void forward(Ast& a, Node s, Facts& f) {
+    switch (a.kind(s)) {
+    case Kind::Assign: {
+        Node e = a.kid(s);
+        uint32_t x = a.id(s);
+        fold(a, e, f);
+        if (is_var(a, e, x)) return remove(a, s);  // x := x
+        kill(f, x);
+        if (auto v = lit_of(a, e)) f[x] = {v};
+        else if (a.kind(e) == Kind::Var) f[x] = {{}, a.id(e)};
+        break;
+    }
+    case Kind::Block: {
+        auto items = a.items(s);
+        for (size_t i = 0; i < items.size(); ++i) {
+            forward(a, items[i], f);
+            if (breaks(a, items[i])) {
+                a.shrink(s, i + 1);  // the rest is unreachable
+                break;
+            }
+        }
+        compact(a, s);
+        break;
+    }
+    case Kind::Loop: {
+        Names w;
+        assigned(a, a.kid(s), w);
+        for (auto& n : w) kill(f, n);
+        Facts inner = f;
+        forward(a, a.kid(s), inner);
+        break;
+    }
+    case Kind::BreakIfz: {
+        fold(a, a.kid(s), f);
+        if (auto v = lit_of(a, a.kid(s))) *v ? remove(a, s) : a.set(s, Kind::Break);
+        break;
+    }
+    case Kind::Print: fold(a, a.kid(s), f); break;
+    case Kind::Case: {
+        // Guards see the facts on entry; false ones go, a true one ends the list
+        auto arms = a.items(s);
+        size_t kept = 0;
+        for (auto arm : arms) {
+            fold(a, a.guard(arm), f);
+            auto v = lit_of(a, a.guard(arm));
+            if (v == 0) continue;
+            arms[kept++] = arm;
+            if (v) break;
+        }
+        a.shrink(s, kept);
+        if (!kept) return remove(a, s);
+        if (lit_of(a, a.guard(arms[0]))) {  // always the first arm
+            a.replace(s, a.kid(arms[0]));
+            return forward(a, s, f);
+        }
+        Names w;
+        for (auto arm : a.items(s)) {
+            Facts inner = f;
+            forward(a, a.kid(arm), inner);
+            assigned(a, a.kid(arm), w);
+        }
+        for (auto& n : w) kill(f, n);
+        break;
+    }
+    default: break;
+    }
+}
+
+// ---------- Backward: dead-store elimination ----------
+
+// Returns the variables live before x given those live after it; `exit` is
+// the live set at the innermost loop's exit. With `remove`, dead assignments
+// are deleted.
+inline Names live(Ast& a, Node x, Names after, const Names& exit, bool remove) {
+    switch (a.kind(x)) {
+    case Kind::Assign:
+        if (!after.contains(a.id(x))) {
+            if (remove) opt::remove(a, x);
+            return after;
+        }
+        after.erase(a.id(x));
+        uses(a, a.kid(x), after);
+        break;
+    case Kind::Block: {
+        auto items = a.items(x);
+        for (size_t i = items.size(); i-- > 0; ) after = live(a, items[i], std::move(after), exit, remove);
+        if (remove) compact(a, x);
+        return after;
+    }
+    case Kind::Loop: {
+        // Live at the loop head: least fixpoint of head = live(body, head)
+        Names head;
+        while (true) {
+            auto next = live(a, a.kid(x), head, after, false);
+            next.insert(head.begin(), head.end());
+            if (next == head) break;
+            head = std::move(next);
+        }
+        if (remove) live(a, a.kid(x), head, after, true);
+        return head;
+    }
+    case Kind::BreakIfz:
+        after.insert(exit.begin(), exit.end());
+        uses(a, a.kid(x), after);
+        break;
+    case Kind::Break: return exit;
+    case Kind::Print: uses(a, a.kid(x), after); break;
+    case Kind::Case: {
+        Names in = after;  // no arm taken
+        for (auto arm : a.items(x)) {
+            auto b = live(a, a.kid(arm), after, exit, remove);
+            in.insert(b.begin(), b.end());
+            uses(a, a.guard(arm), in);
+        }
+        return in;
+    }
+    default: break;
+    }
+    return after;
+}
+
+// ---------- Loop idioms ----------
+
+// The parts of a MulAdd node (see e1.hpp)
+struct Counted { Node acc = NO_NODE, count = NO_NODE, step = NO_NODE; char op = '+'; };
+
+// The parts for `loop { break_ifz n  acc := acc ± e  n := n - 1 }` or
+// `loop { break_ifz n  n := n - 1 }`, if Loop l is one
+inline std::optional<Counted> counted_loop(const Ast& a, Node l) {
+    Node body = a.kid(l);
+    if (a.kind(body) != Kind::Block) return std::nullopt;
+    auto items = a.items(body);
+    if (items.size() < 2 || items.size() > 3 || a.kind(items[0]) != Kind::BreakIfz) return std::nullopt;
+    Node n = a.kid(items[0]);
+    if (a.kind(n) != Kind::Var) return std::nullopt;
+    Counted m;
+    for (auto s : items.subspan(1)) {
+        if (a.kind(s) != Kind::Assign) return std::nullopt;
+        Node dec = a.kid(s);
+        if (a.id(s) == a.id(n)) {
+            if (a.kind(dec) != Kind::Bin || a.op(dec) != '-' || !is_var(a, a.lhs(dec), a.id(n)) ||
+                lit_of(a, a.rhs(dec)) != 1)
+                return std::nullopt;
+            m.count = s;
+        } else if (Node e = self_update(a, s, &m.op); e != NO_NODE) {
+            m.acc = s;
+            m.step = e;
+        } else return std::nullopt;
+    }
+    if (m.count == NO_NODE || (items.size() == 3 && m.acc == NO_NODE)) return std::nullopt;
+    if (m.acc == NO_NODE) return m;
+    Names r;
+    uses(a, m.step, r);
+    if (r.contains(a.id(m.acc)) || r.contains(a.id(n))) return std::nullopt;
+    return m;
+}
+
+// Adds nodes and lists, so item spans are re-read after each recursion
+inline void idioms(Ast& a, Node s) {
+    switch (a.kind(s)) {
+    case Kind::Block: case Kind::Case:
+        for (size_t i = 0; i < a.items(s).size(); ++i) idioms(a, a.items(s)[i]);
+        break;
+    case Kind::Arm: idioms(a, a.kid(s)); break;
+    case Kind::Loop:
+        idioms(a, a.kid(s));
+        if (auto m = counted_loop(a, s)) {
+            Node parts[] = {a.copy(s), m->acc, m->count, m->step};
+            a.set(s, Kind::MulAdd, a.add_list(parts), 0, m->op);
+        }
+        break;
+    default: break;
+    }
+}
+
+// ---------- Pipeline ----------
+
+// Run before resolve()
+inline void optimize(Ast& a) {
+    Names all;
+    names(a, a.root, all);
+    for (uint32_t i = 0; i < ARG_COUNT; ++i) all.erase(i);  // arg1..argN
+    Facts f;
+    for (auto& n : all) f[n] = {0};
+    forward(a, a.root, f);
+    live(a, a.root, {}, {}, true);
+    idioms(a, a.root);
+}
+
+} // namespace opt
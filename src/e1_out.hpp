@@ -0,0 +1,98 @@
+// PL/0 Level 1 — Buffered output runtime (C++23)
+//
+// Shared by every way of running e1: the interpreter engines, programs from
+// the C++ backend, and LLVM IR programs (through the out_* wrappers in
+// e1_rt_bigint.cpp). Output is collected in one per-process buffer and handed
+// to write(2) when the buffer fills and when the program ends, so printing a
+// value is a memcpy rather than a stdio call per line or per digit.
+//
+// The program must call flush() before it exits. With `unbuffered` set
+// (e1 --unbuffered, e1_compile --unbuffered) every line is written at once,
+// for interactive use. A thread that sets `sink` sends its output there
+// instead (runs with an output callback, see libe1.cpp).
+#pragma once
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+
+// Storage class of per-thread runtime state (the sink below, the bigint
+// scratch buffers). The LLVM runtime defines E1_SINGLE_THREAD: its programs
+// run one thread, and the JIT's IR platform does not support TLS.
+#ifdef E1_SINGLE_THREAD
+#define E1_THREAD_LOCAL
+#else
+#define E1_THREAD_LOCAL thread_local
+#endif
+
+namespace out {
+
+inline constexpr size_t BufSize = size_t(1) << 18;  // bytes; flush threshold
+inline char buf[BufSize];
+inline size_t len = 0;
+inline bool unbuffered = false;
+
+// Output collected in `buf` and handed to fn(user, ...) when it fills and
+// when the owner calls flush()
+struct Sink {
+    void (*fn)(void* user, const char* data, size_t len) = nullptr;
+    void* user = nullptr;
+    std::string buf;
+
+    void flush() {
+        if (!buf.empty()) fn(user, buf.data(), buf.size());
+        buf.clear();
+    }
+};
+inline E1_THREAD_LOCAL Sink* sink = nullptr;
+
+inline void write_all(const char* p, size_t n) {
+    while (n > 0) {
+        auto w = ::write(1, p, n);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        p += w;
+        n -= size_t(w);
+    }
+}
+
+inline void flush() {
+    write_all(buf, len);
+    len = 0;
+}
+
+// Appends p[0..n); text longer than the buffer bypasses it
+inline void write(const char* p, size_t n) {
+    if (sink) {
+        sink->buf.append(p, n);
+        if (sink->buf.size() >= BufSize) sink->flush();
+        return;
+    }
+    if (len + n > BufSize) {
+        flush();
+        if (n > BufSize) return write_all(p, n);
+    }
+    std::memcpy(buf + len, p, n);
+    len += n;
+    if (unbuffered) flush();
+}
+
+// Writes v and a newline; T is any signed integer type, including _BitInt(N)
+template <class T> inline void line(T v) {
+    char tmp[sizeof(T) * 3 + 2];  // < 2.41 digits per byte, plus sign and newline
+    char* p = tmp + sizeof tmp;
+    *--p = '\n';
+    bool neg = v < 0;
+    do {  // digit by digit from the remainder, so the minimum value needs no negation
+        int d = int(v % 10);
+        *--p = char('0' + (neg ? -d : d));
+        v /= 10;
+    } while (v != 0);
+    if (neg) *--p = '-';
+    write(p, size_t(tmp + sizeof tmp - p));
+}
+
+} // namespace out
@@ -0,0 +1,292 @@
+// PL/0 Levels 1-2 — Parallel reduction loops (C++23)
+//
+// The outer loop of examples/factorial.e1,
+//
+//   loop { break_ifz iterations  n := facn ... sum := sum + result  iterations := iterations - 1 }
+//
+// runs independent iterations: besides the countdown, the only state one
+// iteration hands to the next is `sum`, and it only adds to it. Such a loop
+// can run as k chunks of its count on k threads, each over its own copy of
+// the variables with its accumulators starting at 0. Adding the chunks'
+// accumulators to the originals in chunk order afterwards gives the
+// sequential result exactly: bigint addition is exact, and fixed-width
+// addition wraps the same way in any order.
+//
+// mark() finds these loops and sets their op to 'p'. The engines run them
+// through reduce() with e1_options.threads workers; the C++ backend
+// (e1_compile --parallel) emits std::jthread workers, see GenCpp. Every run
+// of a marked loop decides again: a count below 2, or a negative one (which
+// never reaches 0), runs the loop sequentially.
+#pragma once
+#include "e1.hpp"
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <thread>
+
+namespace par {
+
+// ---------- Analysis ----------
+
+// A reduction loop: `count` counts down to 0 by one per iteration and
+// appears nowhere else in the body; every other variable the body assigns
+// is an accumulator, only ever updated as `acc := acc ± e` (or a sum with
+// +acc as one term) with e not reading it, or private to an iteration (see
+// mark). The body has no print and leaves the loop only through the zero test.
+struct Reduction {
+    uint32_t count = 0;              // identifier id of the counter
+    Node dec = NO_NODE;              // its `count := count - 1`, a statement of body
+    std::vector<Node> body;          // one iteration: the statements after the zero test
+    std::vector<uint32_t> accs;      // identifier ids of the accumulators
+    std::vector<uint32_t> privates;  // identifier ids of the other assigned variables
+};
+
+// s without enclosing one-statement blocks
+inline Node only(const Ast& a, Node s) {
+    while (a.kind(s) == Kind::Block && a.items(s).size() == 1) s = a.items(s)[0];
+    return s;
+}
+
+// The e1 shape `loop { break_ifz c ... }` or the e2 shape
+// `loop { case { c == 0 -> break  k -> { ... } } }` (k a nonzero literal),
+// and the body's use of each variable. Liveness is left to mark().
+inline std::optional<Reduction> analyze(const Ast& a, Node loop) {
+    Reduction r;
+    Node b = a.kid(loop);
+    if (a.kind(b) == Kind::Block && !a.items(b).empty() && a.kind(a.items(b)[0]) == Kind::BreakIfz) {
+        Node t = a.kid(a.items(b)[0]);
+        if (a.kind(t) != Kind::Var) return std::nullopt;
+        r.count = a.id(t);
+        r.body.assign(a.items(b).begin() + 1, a.items(b).end());
+    } else if (Node c = only(a, b); a.kind(c) == Kind::Case && a.items(c).size() == 2) {
+        Node stop = a.items(c)[0], go = a.items(c)[1];
+        Node g = a.guard(stop), k = a.guard(go);
+        if (a.kind(g) != Kind::Bin || a.op(g) != '=' || a.kind(only(a, a.kid(stop))) != Kind::Break ||
+            a.kind(k) != Kind::Num || a.val(k) == 0)
+            return std::nullopt;
+        Node x = a.lhs(g), z = a.rhs(g);
+        if (a.kind(x) == Kind::Num) std::swap(x, z);
+        if (a.kind(x) != Kind::Var || a.kind(z) != Kind::Num || a.val(z) != 0) return std::nullopt;
+        r.count = a.id(x);
+        Node body = a.kid(go);
+        if (a.kind(body) == Kind::Block) r.body.assign(a.items(body).begin(), a.items(body).end());
+        else r.body = {body};
+    } else {
+        return std::nullopt;
+    }
+
+    for (Node s : r.body) {
+        if (a.kind(s) != Kind::Assign || a.id(s) != r.count) continue;
+        Node d = a.kid(s);
+        if (r.dec != NO_NODE || a.kind(d) != Kind::Bin || a.op(d) != '-' || a.kind(a.lhs(d)) != Kind::Var ||
+            a.id(a.lhs(d)) != r.count || a.kind(a.rhs(d)) != Kind::Num || a.val(a.rhs(d)) != 1)
+            return std::nullopt;
+        r.dec = s;
+    }
+    if (r.dec == NO_NODE) return std::nullopt;
+
+    struct Use { bool read = false, set = false, update = false; };
+    std::vector<Use> use(a.spellings.size());
+    bool ok = true;
+    auto reads = [&](auto& self, Node e) -> void {
+        switch (a.kind(e)) {
+        case Kind::Var: use[a.id(e)].read = true; break;
+        case Kind::Neg: self(self, a.kid(e)); break;
+        case Kind::Bin: self(self, a.lhs(e)); self(self, a.rhs(e)); break;
+        default: break;
+        }
+    };
+    std::vector<Addend> terms;  // of the assignment being looked at
+    // depth: inner loops around s, whose breaks stay inside the body
+    auto walk = [&](auto& self, Node s, int depth) -> void {
+        switch (a.kind(s)) {
+        case Kind::Assign: {
+            if (s == r.dec) break;
+            char op;
+            if (Node d = self_update(a, s, &op); d != NO_NODE) {
+                use[a.id(s)].update = true;
+                reads(reads, d);
+            } else if (sum_terms(a, a.kid(s), terms)) {
+                // x := x + e1 - e2 ...: an update if +x is one of the terms
+                auto self = std::ranges::find_if(terms, [&](Addend t) {
+                    return !t.sub && a.kind(t.x) == Kind::Var && a.id(t.x) == a.id(s);
+                });
+                (self != terms.end() ? use[a.id(s)].update : use[a.id(s)].set) = true;
+                for (auto it = terms.begin(); it != terms.end(); ++it)
+                    if (it != self) reads(reads, it->x);
+            } else {
+                use[a.id(s)].set = true;
+                reads(reads, a.kid(s));
+            }
+            break;
+        }
+        case Kind::Block: for (auto y : a.items(s)) self(self, y, depth); break;
+        case Kind::Loop: self(self, a.kid(s), depth + 1); break;
+        case Kind::BreakIfz: ok &= depth > 0; reads(reads, a.kid(s)); break;
+        case Kind::Break: ok &= depth > 0; break;
+        case Kind::Print: ok = false; break;
+        case Kind::Case:
+            for (auto arm : a.items(s)) {
+                reads(reads, a.guard(arm));
+                self(self, a.kid(arm), depth);
+            }
+            break;
+        // The closed form only adds to the accumulator the loop updates
+        case Kind::MulAdd: self(self, a.loop(s), depth); break;
+        default: break;  // Decl
+        }
+    };
+    for (Node s : r.body) walk(walk, s, 0);
+    auto& c = use[r.count];
+    if (!ok || c.read || c.set || c.update) return std::nullopt;
+    for (uint32_t id = 0; id < use.size(); ++id)
+        if (use[id].update && !use[id].set && !use[id].read) r.accs.push_back(id);
+        else if (use[id].update || use[id].set) r.privates.push_back(id);
+    return r;
+}
+
+// Sets op 'p' on the outermost reduction loops whose private variables are
+// dead at the loop head and after the loop: each iteration assigns them
+// before reading them, and nothing reads what the last one left. Loops
+// inside a marked one are not marked, so workers never nest.
+inline void mark(Ast& a) {
+    Liveness lv{a};
+    Liveness::Set none(a.spellings.size());
+    lv.before(a.root, none, none);
+    auto visit = [&](auto& self, Node s) -> void {
+        switch (a.kind(s)) {
+        case Kind::Block: for (auto y : a.items(s)) self(self, y); break;
+        case Kind::Case: for (auto arm : a.items(s)) self(self, a.kid(arm)); break;
+        case Kind::Loop:
+            if (auto r = analyze(a, s); r && std::ranges::none_of(r->privates, [&](uint32_t id) {
+                    return lv.heads[s][id] || lv.outs[s][id];
+                })) {
+                a.ops[s] = 'p';
+                break;
+            }
+            a.ops[s] = 0;
+            self(self, a.kid(s));
+            break;
+        default: break;
+        }
+    };
+    visit(visit, a.root);
+}
+
+// ---------- Thread Pool ----------
+
+// Worker threads shared by every reduction in the process, started on first
+// use and added to when a reduction wants more. run() queues its tasks and
+// works on the queue itself until they are done, so reductions started on
+// several threads at once (libe1 contexts, e1 --batch) never wait for a
+// worker that is busy elsewhere without helping.
+class Pool {
+    std::mutex m;
+    std::condition_variable_any ready;
+    std::deque<std::function<void()>> tasks;
+    std::vector<std::jthread> workers;  // last: joined before the rest goes
+
+    std::function<void()> take() {
+        std::function<void()> t;
+        if (!tasks.empty()) {
+            t = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        return t;
+    }
+
+public:
+    // Runs fn(0) .. fn(k - 1), fn(0) on the calling thread; rethrows the
+    // first exception any of them threw
+    void run(unsigned k, const std::function<void(unsigned)>& fn) {
+        std::mutex dm;
+        std::condition_variable done;
+        unsigned left = k;
+        std::exception_ptr err;
+        auto task = [&](unsigned i) {
+            std::exception_ptr e;
+            try {
+                fn(i);
+            } catch (...) {
+                e = std::current_exception();
+            }
+            // Under the lock: once run() sees left == 0, no task touches its frame
+            std::lock_guard lock(dm);
+            if (e && !err) err = e;
+            if (--left == 0) done.notify_all();
+        };
+        {
+            std::lock_guard lock(m);
+            while (workers.size() + 1 < k)
+                workers.emplace_back([this](std::stop_token st) {
+                    for (;;) {
+                        std::function<void()> t;
+                        {
+                            std::unique_lock lock(m);
+                            if (!ready.wait(lock, st, [&] { return !tasks.empty(); })) return;
+                            t = take();
+                        }
+                        t();
+                    }
+                });
+            for (unsigned i = 1; i < k; ++i) tasks.push_back([&task, i] { task(i); });
+        }
+        ready.notify_all();
+        task(0);
+        for (;;) {
+            std::function<void()> t;
+            {
+                std::lock_guard lock(m);
+                t = take();
+            }
+            if (!t) break;
+            t();
+        }
+        std::unique_lock lock(dm);
+        done.wait(lock, [&] { return left == 0; });
+        if (err) std::rethrow_exception(err);
+    }
+};
+
+inline Pool& pool() {
+    static Pool p;
+    return p;
+}
+
+// ---------- Execution ----------
+
+// Runs a reduction loop (a marked loop's analyze()) on up to `threads`
+// threads over the register file `regs`: regs[count] is the counter and
+// accs the accumulators' registers. Chunk i gets a copy of the registers
+// with its share of the count and its accumulators at 0, and run(i, copy)
+// must run the loop there to its end. Afterwards the accumulators hold the
+// sums and the counter 0, as after the sequential loop. Returns false,
+// having run nothing, for fewer than 2 threads or iterations.
+inline bool reduce(std::span<Int> regs, uint32_t count, std::span<const uint32_t> accs, unsigned threads,
+                   const std::function<void(unsigned, std::vector<Int>&)>& run) {
+    Int& n = regs[count];
+    if (threads < 2 || n < Int(2)) return false;
+    // k = min(threads, n), counted up in Int (threads may not fit a narrow Int)
+    unsigned k = 1;
+    Int ik = 1;
+    while (k < threads && ik < n) ++k, ik += Int(1);
+    Int q = n / ik, extra = n % ik;
+    std::vector<std::vector<Int>> files(k);
+    pool().run(k, [&](unsigned i) {
+        auto& mine = files[i];
+        mine.assign(regs.begin(), regs.end());
+        mine[count] = Int(int(i)) < extra ? q + Int(1) : q;
+        for (auto x : accs) mine[x] = 0;
+        run(i, mine);
+    });
+    for (auto x : accs)
+        for (auto& f : files) regs[x] += f[x];
+    n = 0;
+    return true;
+}
+
+} // namespace par
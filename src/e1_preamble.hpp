@@ -1,112 +1,352 @@
-// PL/0 Level 1 Compiler - Runtime preambles for code generation
+// PL/0 Levels 1-2 Compiler - Runtime preambles for code generation
 #pragma once
 #include "e1.hpp"
+#include <cstdio>
+
+// Where generated code is written (see e1_gen.hpp)
+inline FILE* gen_out = stdout;
 
 // LLVM IR preamble for bigint (INT_BITS=0)
-constexpr auto LLVM_BIGINT_PREAMBLE = R"(; Bigint runtime (heap vars, stack temps)
-declare void @bi_init(ptr, i64)
+constexpr auto LLVM_BIGINT_PREAMBLE = R"(; Bigint runtime (heap vars, arena temps)
 declare void @bi_copy(ptr, ptr)
-declare void @bi_add(ptr, ptr, ptr)
-declare void @bi_sub(ptr, ptr, ptr)
-declare void @bi_neg(ptr, ptr)
 declare i32 @bi_size(ptr)
-declare i32 @bi_add_size(ptr, ptr)
-declare i32 @bi_sub_size(ptr, ptr)
-declare i32 @bi_neg_size(ptr)
-declare i32 @bi_buf_size(i32)
+declare i32 @bi_cmp(ptr, ptr)
 declare i1 @bi_is_zero(ptr)
+declare i1 @bi_is_neg(ptr)
 declare void @bi_print(ptr)
 declare void @bi_from_str(ptr, ptr)
+declare ptr @bi_arena_new()
+declare void @bi_arena_free(ptr)
+declare void @bi_arena_reset(ptr)
+declare ptr @bi_arena_alloc(ptr, i32)
+declare ptr @bi_init_into(ptr, i64)
+declare ptr @bi_neg_into(ptr, ptr)
+declare ptr @bi_add_into(ptr, ptr, ptr)
+declare ptr @bi_sub_into(ptr, ptr, ptr)
+declare ptr @bi_mul_into(ptr, ptr, ptr)
+declare ptr @bi_div_into(ptr, ptr, ptr)
+declare ptr @bi_mod_into(ptr, ptr, ptr)
+declare ptr @bi_sum_into(ptr, ptr, i32)
 declare void @bi_assign(ptr, ptr, ptr)
+declare void @bi_add_assign(ptr, ptr, ptr)
+declare void @bi_sub_assign(ptr, ptr, ptr)
+declare void @bi_mul_add_assign(ptr, ptr, ptr, ptr)
+declare void @bi_mul_sub_assign(ptr, ptr, ptr, ptr)
 declare void @bi_var_init(ptr, ptr)
 declare void @bi_arg_init(ptr, ptr, i32, ptr, i32)
-declare ptr @llvm.stacksave.p0()
-declare void @llvm.stackrestore.p0(ptr)
+declare void @out_flush()
+declare void @out_unbuffered()
 
 define i32 @main(i32 %argc, ptr %argv) {
 entry:)";
 
+// e2's Euclidean division over sdiv/srem, with x / 0 = x % 0 = 0 (I is the
+// integer type; shared by the fixed-width and hybrid preambles)
+inline std::string llvm_euclid(const std::string& I) {
+    return std::format(R"(define {0} @ediv({0} %a, {0} %b) {{
+entry:
+  %z = icmp eq {0} %b, 0
+  br i1 %z, label %zero, label %div
+zero:
+  ret {0} 0
+div:
+  %q = sdiv {0} %a, %b
+  %r = srem {0} %a, %b
+  %rn = icmp slt {0} %r, 0
+  %bp = icmp sgt {0} %b, 0
+  %d = select i1 %bp, {0} -1, {0} 1
+  %q1 = add {0} %q, %d
+  %res = select i1 %rn, {0} %q1, {0} %q
+  ret {0} %res
+}}
+
+define {0} @emod({0} %a, {0} %b) {{
+entry:
+  %z = icmp eq {0} %b, 0
+  br i1 %z, label %zero, label %div
+zero:
+  ret {0} 0
+div:
+  %r = srem {0} %a, %b
+  %rn = icmp slt {0} %r, 0
+  %bn = sub {0} 0, %b
+  %bp = icmp sgt {0} %b, 0
+  %ab = select i1 %bp, {0} %b, {0} %bn
+  %r1 = add {0} %r, %ab
+  %res = select i1 %rn, {0} %r1, {0} %r
+  ret {0} %res
+}}
+)", I);
+}
+
+// LLVM IR preamble for hybrid integers (--hybrid; e1_hybrid.hpp): int64
+// arithmetic under the overflow intrinsics, with the hy_* promotion paths
+// declared cold. !0 weights those branches; gen() defines it after main.
+inline std::string llvm_hybrid_preamble() {
+    return std::format(R"(; Hybrid runtime (int64 vars and temps, promoted to heap bigints)
+@hy_ntemps = external global i32
+declare ptr @hy_op(i32, i64, ptr, i64, ptr, ptr) cold
+declare i32 @hy_cmp(i64, ptr, i64, ptr) cold
+declare void @hy_assign(ptr, ptr, ptr, i64, ptr) cold
+declare void @hy_update(i32, ptr, ptr, ptr, i64, ptr) cold
+declare void @hy_mul_add(i32, ptr, ptr, ptr, i64, ptr, i64, ptr) cold
+declare void @hy_release() cold
+declare void @hy_print(i64, ptr)
+declare void @hy_arg_init(ptr, ptr, ptr, i32, ptr, i32)
+declare void @out_flush()
+declare void @out_unbuffered()
+declare {{i64, i1}} @llvm.sadd.with.overflow.i64(i64, i64)
+declare {{i64, i1}} @llvm.ssub.with.overflow.i64(i64, i64)
+declare {{i64, i1}} @llvm.smul.with.overflow.i64(i64, i64)
+
+{}
+define i32 @main(i32 %argc, ptr %argv) {{
+entry:
+  %hy.out = alloca i64)", llvm_euclid("i64"));
+}
+
 // LLVM IR preamble for fixed-width integers
+// print_int formats into a stack buffer (digits from the remainder, so the
+// minimum value needs no negation) and hands the line to the shared output
+// buffer in e1_rt_bigint.cpp.
 inline std::string llvm_int_preamble(const std::string& I) {
     auto ret = INT_BITS <= 32 ? "  %v = trunc i64 %v64 to i32\n  ret i32 %v"
              : INT_BITS <= 64 ? "  ret i64 %v64"
              : std::format("  %v = sext i64 %v64 to {0}\n  ret {0} %v", I);
-    auto dig = INT_BITS <= 32 ? "  %c = add i32 %rem, 48"
-             : std::format("  %d = trunc {} %rem to i32\n  %c = add i32 %d, 48", I);
-    return std::format(R"(declare i32 @putchar(i32)
-declare i64 @strtol(ptr, ptr, i32)
+    auto dig = INT_BITS <= 8 ? "%ra" : "%d";
+    auto trunc = INT_BITS <= 8 ? std::string() : std::format("  %d = trunc {} %ra to i8\n", I);
+    int len = INT_BITS * 31 / 100 + 3;  // digits, sign and newline
+    return std::format(R"(declare i64 @strtol(ptr, ptr, i32)
+declare void @out_write(ptr, i64)
+declare void @out_flush()
+declare void @out_unbuffered()
 
-define void @print_int_rec({0} %v) {{ %z = icmp eq {0} %v, 0  br i1 %z, label %done, label %print
-print: %div = sdiv {0} %v, 10  %rem = srem {0} %v, 10  call void @print_int_rec({0} %div)
-{2}  call i32 @putchar(i32 %c)  br label %done
-done: ret void }}
-
-define void @print_int({0} %v) {{ %z = icmp eq {0} %v, 0  br i1 %z, label %zero, label %nonzero
-zero: call i32 @putchar(i32 48)  br label %done
-nonzero: call void @print_int_rec({0} %v)  br label %done
-done: call i32 @putchar(i32 10)  ret void }}
+define void @print_int({0} %v) {{
+entry:
+  %buf = alloca [{3} x i8]
+  %end = getelementptr i8, ptr %buf, i64 {3}
+  %nl = getelementptr i8, ptr %end, i64 -1
+  store i8 10, ptr %nl
+  %neg = icmp slt {0} %v, 0
+  br label %digit
+digit:
+  %x = phi {0} [ %v, %entry ], [ %q, %digit ]
+  %p = phi ptr [ %nl, %entry ], [ %p1, %digit ]
+  %q = sdiv {0} %x, 10
+  %r = srem {0} %x, 10
+  %rn = sub {0} 0, %r
+  %ra = select i1 %neg, {0} %rn, {0} %r
+{4}  %c = add i8 {2}, 48
+  %p1 = getelementptr i8, ptr %p, i64 -1
+  store i8 %c, ptr %p1
+  %more = icmp ne {0} %q, 0
+  br i1 %more, label %digit, label %sign
+sign:
+  br i1 %neg, label %minus, label %emit
+minus:
+  %pm = getelementptr i8, ptr %p1, i64 -1
+  store i8 45, ptr %pm
+  br label %emit
+emit:
+  %start = phi ptr [ %p1, %sign ], [ %pm, %minus ]
+  %s = ptrtoint ptr %start to i64
+  %e = ptrtoint ptr %end to i64
+  %n = sub i64 %e, %s
+  call void @out_write(ptr %start, i64 %n)
+  ret void
+}}
 
+{5}
 define {0} @parse_arg(i32 %argc, ptr %argv, i32 %idx) {{ %has = icmp sgt i32 %argc, %idx  br i1 %has, label %read, label %default
 read: %i = sext i32 %idx to i64  %p = getelementptr ptr, ptr %argv, i64 %i  %s = load ptr, ptr %p  %v64 = call i64 @strtol(ptr %s, ptr null, i32 10)
 {1}
 default: ret {0} 0 }}
 
 define i32 @main(i32 %argc, ptr %argv) {{
-entry:)", I, ret, dig);
+entry:)", I, ret, dig, len, trunc, llvm_euclid(I));
 }
 
 // C++ preamble - unified runtime interface
-// INT_BITS can be overridden via -D on the clang++ line
-inline void cpp_preamble(bool = false) {
-    std::puts(R"(#ifndef INT_BITS
+// INT_BITS can be overridden via -D on the clang++ line. Hybrid programs
+// (--hybrid) define E1_HYBRID and use hybrid::Num from e1_hybrid.hpp.
+inline void cpp_preamble(bool hybrid = false) {
+    if (hybrid)
+        std::print(gen_out, "#define E1_HYBRID 1\n");
+    std::println(gen_out, "{}", R"(#ifndef INT_BITS
 #define INT_BITS 0
 #endif
 
-#if INT_BITS == 0
+#if defined(E1_HYBRID)
+#include "e1_hybrid.hpp"
+#define VAR(name) hybrid::Num name##_v
+#define ARG(name, idx) auto name##_v = hybrid::arg(argc, argv, idx)
+#define REF(name) (name##_v)
+#define ASSIGN(name, val) name##_v = (val)
+#define MOVE(name, from) swap(name##_v, from##_v)
+#define ADD_ASSIGN(name, val) hybrid::update<'+'>(name##_v, val)
+#define SUB_ASSIGN(name, val) hybrid::update<'-'>(name##_v, val)
+#define MUL_ADD_ASSIGN(name, a, b) hybrid::mul_add(name##_v, a, b, false)
+#define MUL_SUB_ASSIGN(name, a, b) hybrid::mul_add(name##_v, a, b, true)
+#define IS_ZERO(x) ((x).v == 0)
+#define IS_NEG(x) ((x).v < 0)
+#define PRINT(x) hybrid::print(x)
+#define LIT(name, v) const hybrid::Num name(v)
+#define NEG(name, a) auto name = hybrid::binop<'-'>(hybrid::Num(), a)
+#define ADD(name, a, b) auto name = hybrid::binop<'+'>(a, b)
+#define SUB(name, a, b) auto name = hybrid::binop<'-'>(a, b)
+#define MUL(name, a, b) auto name = hybrid::binop<'*'>(a, b)
+#define DIV(name, a, b) auto name = hybrid::binop<'/'>(a, b)
+#define MOD(name, a, b) auto name = hybrid::binop<'%'>(a, b)
+#define CMP(name, op, a, b) LIT(name, hybrid::compare(a, b) op 0)
+#define TEMPS (void)0
+#elif INT_BITS == 0
 #include "e1_bigint.hpp"
 #define VAR(name) auto name##_v = bigint::var_init()
 #define ARG(name, idx) auto name##_v = bigint::arg_init(argc, argv, idx)
 #define REF(name) (*name##_v.ptr)
 #define ASSIGN(name, val) bigint::assign(name##_v, val)
+// name := from when from is dead after it (see mark_moves): the variables
+// exchange buffers, so no limb is copied
+#define MOVE(name, from) std::swap(name##_v, from##_v)
+#define ADD_ASSIGN(name, val) bigint::add_assign(name##_v, val)
+#define SUB_ASSIGN(name, val) bigint::sub_assign(name##_v, val)
+#define MUL_ADD_ASSIGN(name, a, b) bigint::mul_add_assign(name##_v, a, b, false)
+#define MUL_SUB_ASSIGN(name, a, b) bigint::mul_add_assign(name##_v, a, b, true)
 #define IS_ZERO(x) bigint::is_zero(x)
+#define IS_NEG(x) bigint::is_neg(x)
 #define PRINT(x) bigint::print(x)
+// Literals are one limb on the stack; computed temporaries come from one
+// scratch arena, and TEMPS (opening their statement's block) releases them
+// when the block is left
+inline bigint::Arena scratch;
+#define TEMPS const bigint::Arena::Scope temps_(scratch)
+#define TMP(name, limbs) auto& name = *scratch.alloc(limbs)
 #define LIT(name, v) BIGINT_LIT(name); bigint::init(name, v)
-#define NEG(name, a) BIGINT_TMP(name, (a).size); bigint::neg(name, a)
-#define ADD(name, a, b) BIGINT_TMP(name, bigint::add_size(a, b)); bigint::add(name, a, b)
-#define SUB(name, a, b) BIGINT_TMP(name, bigint::sub_size(a, b)); bigint::sub(name, a, b)
+#define NEG(name, a) TMP(name, (a).size); bigint::neg(name, a)
+#define ADD(name, a, b) TMP(name, bigint::add_size(a, b)); bigint::add(name, a, b)
+#define SUB(name, a, b) TMP(name, bigint::sub_size(a, b)); bigint::sub(name, a, b)
+#define MUL(name, a, b) TMP(name, bigint::mul_size(a, b)); bigint::mul(name, a, b)
+#define DIV(name, a, b) TMP(name, bigint::div_size(a, b)); bigint::divmod(&name, nullptr, a, b)
+#define MOD(name, a, b) TMP(name, bigint::mod_size(a, b)); bigint::divmod(nullptr, &name, a, b)
+#define CMP(name, op, a, b) LIT(name, bigint::cmp(a, b) op 0)
+// SUM(name, PLUS(a), MINUS(b), ...): a - b + ... in one pass (bigint::sum)
+#define PLUS(x) bigint::Term{&(x), false}
+#define MINUS(x) bigint::Term{&(x), true}
+#define SUM(name, ...) const bigint::Term name##_ops[] = {__VA_ARGS__}; \
+  TMP(name, bigint::sum_size(name##_ops, std::size(name##_ops))); bigint::sum(name, name##_ops, std::size(name##_ops))
 #else
-#include <print>
 #include <cstdlib>
+#include <initializer_list>
+#include "e1_out.hpp"
 using Int = _BitInt(INT_BITS);
-inline std::string to_string(Int v) { if (!v) return "0"; std::string s; bool n = v < 0; if (n) v = -v; while (v) { s = char('0' + v % 10) + s; v /= 10; } return n ? "-" + s : s; }
+using UInt = unsigned _BitInt(INT_BITS);
 #define VAR(name) Int name = 0
 #define ARG(name, idx) Int name = argc > idx ? std::atoll(argv[idx]) : 0
 #define REF(name) (name)
 #define ASSIGN(name, val) name = (val)
+#define MOVE(name, from) name = from
+#define ADD_ASSIGN(name, val) name += (val)
+#define SUB_ASSIGN(name, val) name -= (val)
+// Counted-loop closed form; wraps like the additions it replaces
+#define MUL_ADD_ASSIGN(name, a, b) name = Int(UInt(name) + UInt(a) * UInt(b))
+#define MUL_SUB_ASSIGN(name, a, b) name = Int(UInt(name) - UInt(a) * UInt(b))
 #define IS_ZERO(x) ((x) == 0)
-#define PRINT(x) std::print("{}\n", to_string(x))
+#define IS_NEG(x) ((x) < 0)
+#define PRINT(x) out::line(x)
 #define LIT(name, v) Int name = (v)
 #define NEG(name, a) Int name = -(a)
 #define ADD(name, a, b) Int name = (a) + (b)
 #define SUB(name, a, b) Int name = (a) - (b)
+#define MUL(name, a, b) Int name = (a) * (b)
+#define DIV(name, a, b) Int name = ediv(a, b)
+#define MOD(name, a, b) Int name = emod(a, b)
+#define CMP(name, op, a, b) Int name = (a) op (b)
+#define TEMPS (void)0
+// Wraps like the additions it replaces
+#define PLUS(x) UInt(x)
+#define MINUS(x) (UInt(0) - UInt(x))
+#define SUM(name, ...) Int name = Int(usum({__VA_ARGS__}))
+inline UInt usum(std::initializer_list<UInt> ops) {
+  UInt s = 0;
+  for (UInt v : ops) s += v;
+  return s;
+}
+// e2 division is Euclidean (0 <= a % b < |b|), with x / 0 = x % 0 = 0
+inline Int ediv(Int a, Int b) {
+  if (b == 0) return 0;
+  Int q = a / b;
+  return a % b < 0 ? q + (b > 0 ? -1 : 1) : q;
+}
+inline Int emod(Int a, Int b) {
+  if (b == 0) return 0;
+  Int r = a % b;
+  return r < 0 ? r + (b > 0 ? b : -b) : r;
+}
 #endif)");
 }
 
+// C++ preamble addition for parallel loops (e1_compile --parallel, see
+// GenCpp::reduction): per-mode storage for the workers' accumulator parts,
+// and the number of workers for a count
+constexpr auto CPP_PAR_PREAMBLE = R"(#include <algorithm>
+#include <thread>
+#include <vector>
+#if defined(E1_HYBRID)
+inline int64_t par_count(const hybrid::Num& x) { return x.small() ? x.v : -1; }
+#define PARTS(name, k) std::vector<hybrid::Num> name##_parts(k)
+#define KEEP(name, i) swap(name##_parts[i], name##_v)
+#define ADD_PART(name, i) hybrid::update<'+'>(name##_v, name##_parts[i])
+#define DROP(name) (void)0
+#define PRIVATE_TEMPS (void)0
+#elif INT_BITS == 0
+inline int64_t par_count(const bigint::Raw& x) {
+  if (x.size == 0) return 0;
+  return x.neg || x.size > 1 || uint64_t(x.limbs[0]) > uint64_t(INT64_MAX) ? -1 : int64_t(x.limbs[0]);
+}
+#define PARTS(name, k) std::vector<bigint::Var> name##_parts(k)
+#define KEEP(name, i) name##_parts[i] = name##_v
+#define ADD_PART(name, i) bigint::add_assign(name##_v, *name##_parts[i].ptr), std::free(name##_parts[i].ptr)
+#define DROP(name) std::free(name##_v.ptr)
+// Temporaries of a worker come from its own arena
+#define PRIVATE_TEMPS bigint::Arena scratch
+#else
+inline int64_t par_count(Int x) { return x < 0 || x > INT64_MAX ? -1 : int64_t(x); }
+#define PARTS(name, k) std::vector<Int> name##_parts(k)
+#define KEEP(name, i) name##_parts[i] = name
+#define ADD_PART(name, i) ADD_ASSIGN(name, name##_parts[i])
+#define DROP(name) (void)0
+#define PRIVATE_TEMPS (void)0
+#endif
+// Workers for n iterations, at most `want` (0: one per core); 0 runs the
+// loop sequentially: fewer than 2 iterations, or a count that is negative
+// or not an int64
+inline unsigned par_chunks(int64_t n, unsigned want) {
+  if (!want) want = std::thread::hardware_concurrency();
+  return n < 2 || want < 2 ? 0 : unsigned(std::min<int64_t>(n, want));
+})";
+
 // Emit argument parsing
 inline void emit_args_llvm_bigint() {
     for (int i = 1; i <= ARG_COUNT; ++i) {
-        std::print("  %arg{0} = alloca ptr\n", i);
-        std::print("  %arg{0}_cap = alloca i32\n", i);
-        std::print("  call void @bi_arg_init(ptr %arg{0}, ptr %arg{0}_cap, i32 %argc, ptr %argv, i32 {0})\n", i);
+        std::print(gen_out, "  %arg{0} = alloca ptr\n", i);
+        std::print(gen_out, "  %arg{0}_cap = alloca i32\n", i);
+        std::print(gen_out, "  call void @bi_arg_init(ptr %arg{0}, ptr %arg{0}_cap, i32 %argc, ptr %argv, i32 {0})\n", i);
+    }
+}
+
+inline void emit_args_llvm_hybrid() {
+    for (int i = 1; i <= ARG_COUNT; ++i) {
+        std::print(gen_out, "  %arg{0} = alloca i64\n  %arg{0}.big = alloca ptr\n  %arg{0}.cap = alloca i32\n", i);
+        std::print(gen_out, "  call void @hy_arg_init(ptr %arg{0}, ptr %arg{0}.big, ptr %arg{0}.cap, i32 %argc, ptr %argv, i32 {0})\n", i);
     }
 }
 
 inline void emit_args_llvm_int(const std::string& I) {
     for (int i = 1; i <= ARG_COUNT; ++i)
-        std::print("  %arg{0} = alloca {1}\n  %a{0} = call {1} @parse_arg(i32 %argc, ptr %argv, i32 {0})\n  store {1} %a{0}, ptr %arg{0}\n", i, I);
+        std::print(gen_out, "  %arg{0} = alloca {1}\n  %a{0} = call {1} @parse_arg(i32 %argc, ptr %argv, i32 {0})\n  store {1} %a{0}, ptr %arg{0}\n", i, I);
 }
 
 inline void emit_args_cpp() {
     for (int i = 1; i <= ARG_COUNT; ++i)
-        std::print("  Int arg{0} = argc > {0} ? std::atoll(argv[{0}]) : 0;\n", i);
+        std::print(gen_out, "  Int arg{0} = argc > {0} ? std::atoll(argv[{0}]) : 0;\n", i);
 }
@@ -1,24 +1,73 @@
 // LLVM runtime: extern "C" wrappers around e1_bigint.hpp
 // Compile to .ll for linking with generated LLVM IR
+#define E1_SINGLE_THREAD 1  // no TLS in the runtime (see e1_out.hpp)
+#define E1_GENERIC_KERNELS 1  // no inline asm in the IR (see add_nn in e1_bigint.hpp)
 #include "e1_bigint.hpp"
+#include "e1_hybrid.hpp"
+#include <vector>
 
 using namespace bigint;
 
+// Promoted temporaries of hybrid programs, freed by hy_release
+static std::vector<Raw*> hy_temps;
+
 extern "C" {
 
-void bi_init(Raw* out, SLimb v) { init(*out, v); }
 void bi_copy(Raw* dst, const Raw* src) { copy(*dst, *src); }
-Size bi_add_size(const Raw* a, const Raw* b) { return add_size(*a, *b); }
-Size bi_sub_size(const Raw* a, const Raw* b) { return sub_size(*a, *b); }
-Size bi_neg_size(const Raw* a) { return a->size; }
 Size bi_size(const Raw* a) { return a->size; }
-void bi_add(Raw* out, const Raw* a, const Raw* b) { add(*out, *a, *b); }
-void bi_sub(Raw* out, const Raw* a, const Raw* b) { sub(*out, *a, *b); }
-void bi_neg(Raw* out, const Raw* a) { neg(*out, *a); }
+int bi_cmp(const Raw* a, const Raw* b) { return cmp(*a, *b); }
 bool bi_is_zero(const Raw* a) { return is_zero(*a); }
+bool bi_is_neg(const Raw* a) { return is_neg(*a); }
 void bi_print(const Raw* v) { print(*v); }
 void bi_from_str(Raw* out, const char* s) { from_str(*out, s); }
-Size bi_buf_size(Size limbs) { return Raw::buf_size(limbs); }
+
+// Temporaries: each operation sizes its result, takes it from the program's
+// scratch arena and computes it in one call. bi_arena_reset ends a statement.
+Arena* bi_arena_new() { return new Arena; }
+void bi_arena_free(Arena* s) { delete s; }
+void bi_arena_reset(Arena* s) { s->release({}); }
+void* bi_arena_alloc(Arena* s, Size bytes) { return s->alloc_bytes(bytes); }
+Raw* bi_init_into(Arena* s, SLimb v) {
+    auto* r = s->alloc(1);
+    init(*r, v);
+    return r;
+}
+Raw* bi_neg_into(Arena* s, const Raw* a) {
+    auto* r = s->alloc(a->size);
+    neg(*r, *a);
+    return r;
+}
+Raw* bi_add_into(Arena* s, const Raw* a, const Raw* b) {
+    auto* r = s->alloc(add_size(*a, *b));
+    add(*r, *a, *b);
+    return r;
+}
+Raw* bi_sub_into(Arena* s, const Raw* a, const Raw* b) {
+    auto* r = s->alloc(sub_size(*a, *b));
+    sub(*r, *a, *b);
+    return r;
+}
+Raw* bi_mul_into(Arena* s, const Raw* a, const Raw* b) {
+    auto* r = s->alloc(mul_size(*a, *b));
+    mul(*r, *a, *b);
+    return r;
+}
+Raw* bi_div_into(Arena* s, const Raw* a, const Raw* b) {
+    auto* r = s->alloc(div_size(*a, *b));
+    divmod(r, nullptr, *a, *b);
+    return r;
+}
+Raw* bi_mod_into(Arena* s, const Raw* a, const Raw* b) {
+    auto* r = s->alloc(mod_size(*a, *b));
+    divmod(nullptr, r, *a, *b);
+    return r;
+}
+// n-ary sums: t[0..k) are {const Raw*, bool sub} pairs ({ptr, i8} in IR)
+Raw* bi_sum_into(Arena* s, const Term* t, Size k) {
+    auto* r = s->alloc(sum_size(t, k));
+    sum(*r, t, k);
+    return r;
+}
 
 void bi_var_init(Raw** var_ptr, Size* cap_ptr) {
     auto v = var_init();
@@ -31,10 +80,84 @@ void bi_assign(Raw** var_ptr, Size* cap_ptr, const Raw* value) {
     *var_ptr = v.ptr;
     *cap_ptr = v.cap;
 }
+void bi_add_assign(Raw** var_ptr, Size* cap_ptr, const Raw* value) {
+    Var v{*var_ptr, *cap_ptr};
+    add_assign(v, *value);
+    *var_ptr = v.ptr;
+    *cap_ptr = v.cap;
+}
+void bi_sub_assign(Raw** var_ptr, Size* cap_ptr, const Raw* value) {
+    Var v{*var_ptr, *cap_ptr};
+    sub_assign(v, *value);
+    *var_ptr = v.ptr;
+    *cap_ptr = v.cap;
+}
+void bi_mul_add_assign(Raw** var_ptr, Size* cap_ptr, const Raw* a, const Raw* b) {
+    Var v{*var_ptr, *cap_ptr};
+    mul_add_assign(v, *a, *b, false);
+    *var_ptr = v.ptr;
+    *cap_ptr = v.cap;
+}
+void bi_mul_sub_assign(Raw** var_ptr, Size* cap_ptr, const Raw* a, const Raw* b) {
+    Var v{*var_ptr, *cap_ptr};
+    mul_add_assign(v, *a, *b, true);
+    *var_ptr = v.ptr;
+    *cap_ptr = v.cap;
+}
 void bi_arg_init(Raw** var_ptr, Size* cap_ptr, int argc, char** argv, int idx) {
     auto v = arg_init(argc, argv, idx);
     *var_ptr = v.ptr;
     *cap_ptr = v.cap;
 }
 
+// --- Hybrid integers (e1_compile --hybrid, e1_hybrid.hpp) ---
+// A variable is (int64_t v, Raw* ptr, Size cap) in three allocas, with ptr
+// null while the value fits in int64. Promoted temporaries are heap bigints
+// that live until hy_release at the end of the statement that made them;
+// generated code calls it only when hy_ntemps is nonzero.
+int hy_ntemps = 0;
+
+Raw* hy_op(int op, int64_t av, const Raw* ab, int64_t bv, const Raw* bb, int64_t* out) {
+    Var r = {};
+    hybrid::op(char(op), *out, r, av, ab, bv, bb);
+    if (r.ptr) hy_temps.push_back(r.ptr), hy_ntemps++;
+    return r.ptr;
+}
+int hy_cmp(int64_t av, const Raw* ab, int64_t bv, const Raw* bb) { return hybrid::cmp(av, ab, bv, bb); }
+void hy_release() {
+    for (auto* t : hy_temps) std::free(t);
+    hy_temps.clear();
+    hy_ntemps = 0;
+}
+void hy_assign(int64_t* v, Raw** var_ptr, Size* cap_ptr, int64_t sv, const Raw* sb) {
+    Var x{*var_ptr, *cap_ptr};
+    hybrid::assign(*v, x, sv, sb);
+    *var_ptr = x.ptr;
+    *cap_ptr = x.cap;
+}
+void hy_update(int op, int64_t* v, Raw** var_ptr, Size* cap_ptr, int64_t bv, const Raw* bb) {
+    Var x{*var_ptr, *cap_ptr};
+    hybrid::update(char(op), *v, x, bv, bb);
+    *var_ptr = x.ptr;
+    *cap_ptr = x.cap;
+}
+void hy_mul_add(int op, int64_t* v, Raw** var_ptr, Size* cap_ptr, int64_t nv, const Raw* nb, int64_t ev, const Raw* eb) {
+    Var x{*var_ptr, *cap_ptr};
+    hybrid::mul_add(op == '-', *v, x, nv, nb, ev, eb);
+    *var_ptr = x.ptr;
+    *cap_ptr = x.cap;
+}
+void hy_print(int64_t v, const Raw* b) { hybrid::print(v, b); }
+void hy_arg_init(int64_t* v, Raw** var_ptr, Size* cap_ptr, int argc, char** argv, int idx) {
+    Var x;
+    hybrid::arg_init(*v, x, argc, argv, idx);
+    *var_ptr = x.ptr;
+    *cap_ptr = x.cap;
+}
+
+// Shared output buffer (e1_out.hpp), also used by fixed-width programs
+void out_write(const char* p, size_t n) { out::write(p, n); }
+void out_flush() { out::flush(); }
+void out_unbuffered() { out::unbuffered = true; }
+
 }
@@ -0,0 +1,404 @@
+// PL/0 Levels 1-2 — Bytecode compiler and register VM (C++23)
+//
+// Lowers the AST from parse_program into three-address bytecode whose operands
+// are resolved register indices, then runs it with direct-threaded dispatch
+// (computed goto, GNU labels-as-values; supported by clang and gcc).
+//
+// Register file layout: [variables][constants][temporaries]
+//   - variables:   one register per slot assigned by resolve(), arg1..argN first
+//   - constants:   one register per distinct literal, loaded before execution
+//   - temporaries: expression results, reused from statement to statement
+// Literals therefore cost nothing inside loops, and variable/literal operands
+// need no load instruction.
+#pragma once
+#include "e1.hpp"
+#include "e1_par.hpp"
+#include <cstdint>
+#include <unordered_map>
+
+namespace vm {
+
+enum class Op : uint8_t {
+    MOV,     // a := b
+    ADD,     // a := b + c
+    SUB,     // a := b - c
+    NEG,     // a := -b
+    ADDTO,   // a += b             (self-update `x := x + e`, in place)
+    SUBFROM, // a -= b             (self-update `x := x - e`, in place)
+    JZ,      // if a == 0 goto c
+    JEQ,     // if a == b goto c   (fused `break_ifz x - y`)
+    JMP,     // goto c
+    PRINT,   // print a
+    HALT,
+    BRKERR,  // break_ifz outside loop
+    // e2
+    MUL,     // a := b * c
+    DIV,     // a := b / c         (Euclidean, see ediv)
+    MOD,     // a := b % c
+    EQ, NE, LT, GT, LE, GE,  // a := (b op c) ? 1 : 0
+    JNE,     // if a != b goto c   (fused case guard `x == y`)
+    // counted loops (MulAdd)
+    JNEG,    // if a < 0 goto c
+    MULADD,  // a += b * c
+    MULSUB,  // a -= b * c
+    SUM,     // a := the n-ary sum of the operand run at terms[b] (see Program)
+    MOVE,    // a := b, leaving b a's old value (`x := y` with y dead, see mark_moves)
+    PAR,     // run reduction loop b (counter a) on threads, then goto c; if it
+             // declines, go on into the loop (see e1_par.hpp)
+};
+
+// Three-address opcode for an e2 Bin operator other than + and -
+inline Op binop_code(char op) {
+    switch (op) {
+        case '*': return Op::MUL;
+        case '/': return Op::DIV;
+        case '%': return Op::MOD;
+        case '=': return Op::EQ;
+        case '!': return Op::NE;
+        case '<': return Op::LT;
+        case '>': return Op::GT;
+        case 'l': return Op::LE;
+        default:  return Op::GE;
+    }
+}
+
+struct Instr {
+    Op op;
+    uint32_t a = 0, b = 0, c = 0;
+};
+
+struct Reduce;
+
+struct Program {
+    std::vector<Instr> code;
+    std::vector<std::pair<uint32_t, int>> consts;  // register -> literal value
+    // SUM operand runs: the count, then one register per operand, with
+    // SubTerm set if it is subtracted
+    std::vector<uint32_t> terms;
+    uint32_t nregs = 0;
+    std::vector<Reduce> reduces;  // PAR loops
+};
+
+// A loop PAR runs in parallel: its code on its own, with a HALT where the
+// loop exits, which each worker runs over its copy of the registers
+struct Reduce {
+    Program body;
+    uint32_t count = 0;          // counter register
+    std::vector<uint32_t> accs;  // accumulator registers
+    unsigned threads = 0;
+};
+
+inline constexpr uint32_t SubTerm = 1u << 31;
+
+// dst := the sum of the operand run `run` over the registers r
+inline void sum(Int& dst, const uint32_t* run, Int* r) {
+    uint32_t k = run[0];
+    SumTerm t[k];
+    for (uint32_t i = 0; i < k; i++) t[i] = {&r[run[i + 1] & ~SubTerm], (run[i + 1] & SubTerm) != 0};
+    ::sum(dst, t, k);
+}
+
+// ---------- Compiler ----------
+
+struct Compiler {
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    const Ast& a;
+    unsigned threads = 0;  // > 1: marked loops (par::mark) get a PAR
+    Program p;
+    std::unordered_map<int, uint32_t> const_reg;
+    uint32_t tmp_base = 0, tmp = 0;
+    std::vector<std::vector<size_t>> exits;  // per enclosing loop: jumps to its exit
+    std::vector<size_t> orphans;             // break sites outside any loop
+
+    // Pre-pass: collect literals so they can be numbered after the variables
+    // and temporaries can start right after them.
+    void collect(Node x, std::vector<int>& lits) {
+        switch (a.kind(x)) {
+        case Kind::Num: lits.push_back(a.val(x)); break;
+        case Kind::Neg: case Kind::Assign: case Kind::Loop: case Kind::BreakIfz: case Kind::Print:
+            collect(a.kid(x), lits);
+            break;
+        case Kind::Bin: collect(a.lhs(x), lits); collect(a.rhs(x), lits); break;
+        case Kind::Arm: collect(a.guard(x), lits); collect(a.kid(x), lits); break;
+        case Kind::Block: case Kind::Case: for (auto s : a.items(x)) collect(s, lits); break;
+        case Kind::MulAdd: collect(a.loop(x), lits); lits.push_back(0); break;
+        default: break;
+        }
+    }
+
+    size_t emit(Op op, uint32_t a = 0, uint32_t b = 0, uint32_t c = 0) {
+        p.code.push_back({op, a, b, c});
+        return p.code.size() - 1;
+    }
+
+    uint32_t dest(uint32_t want) {
+        if (want != NONE) return want;
+        p.nregs = std::max(p.nregs, tmp + 1);
+        return tmp++;
+    }
+
+    // Compile x into register `want` (or a fresh temporary if NONE); returns
+    // the register holding the value. Variables and literals are returned in
+    // place without emitting code.
+    uint32_t expr(Node x, uint32_t want = NONE) {
+        uint32_t r = NONE;
+        switch (a.kind(x)) {
+        case Kind::Num: r = const_reg.at(a.val(x)); break;
+        case Kind::Var: r = uint32_t(a.slot(x)); break;
+        case Kind::Neg: {
+            auto v = expr(a.kid(x));
+            return emit(Op::NEG, r = dest(want), v), r;
+        }
+        case Kind::Bin: {
+            // Chains of + and - become one SUM of their operands
+            if (std::vector<Addend> terms; sum_terms(a, x, terms)) {
+                std::vector<uint32_t> run = {uint32_t(terms.size())};
+                for (auto [y, sub] : terms) run.push_back(expr(y) | (sub ? SubTerm : 0));
+                auto at = uint32_t(p.terms.size());
+                p.terms.insert(p.terms.end(), run.begin(), run.end());
+                return emit(Op::SUM, r = dest(want), at), r;
+            }
+            auto l = expr(a.lhs(x)), rr = expr(a.rhs(x));
+            auto op = a.op(x) == '+' ? Op::ADD : a.op(x) == '-' ? Op::SUB : binop_code(a.op(x));
+            return emit(op, r = dest(want), l, rr), r;
+        }
+        default: break;
+        }
+        if (want != NONE && want != r) emit(Op::MOV, want, r);
+        return want != NONE ? want : r;
+    }
+
+    void stmt(Node x) {
+        tmp = tmp_base;
+        switch (a.kind(x)) {
+        case Kind::Assign: {
+            char op;
+            if (a.op(x) == 'm') emit(Op::MOVE, a.slot(x), a.slot(a.kid(x)));
+            else if (Node d = self_update(a, x, &op); d != NO_NODE) emit(op == '+' ? Op::ADDTO : Op::SUBFROM, a.slot(x), expr(d));
+            else expr(a.kid(x), uint32_t(a.slot(x)));
+            break;
+        }
+        case Kind::Block: for (auto s : a.items(x)) stmt(s); break;
+        case Kind::Loop: {
+            size_t par = a.op(x) == 'p' && threads > 1 ? emit(Op::PAR) : SIZE_MAX;
+            auto head = uint32_t(p.code.size());
+            exits.emplace_back();
+            stmt(a.kid(x));
+            emit(Op::JMP, 0, 0, head);
+            for (auto at : exits.back()) p.code[at].c = uint32_t(p.code.size());
+            exits.pop_back();
+            if (par != SIZE_MAX) reduction(x, par, head);
+            break;
+        }
+        case Kind::BreakIfz: {
+            size_t at;
+            if (Node d = a.kid(x); a.kind(d) == Kind::Bin && a.op(d) == '-') {
+                auto l = expr(a.lhs(d)), r = expr(a.rhs(d));
+                at = emit(Op::JEQ, l, r);
+            } else {
+                at = emit(Op::JZ, expr(a.kid(x)));
+            }
+            (exits.empty() ? orphans : exits.back()).push_back(at);
+            break;
+        }
+        case Kind::Print: emit(Op::PRINT, expr(a.kid(x))); break;
+        case Kind::Break: (exits.empty() ? orphans : exits.back()).push_back(emit(Op::JMP)); break;
+        case Kind::Case: {
+            // Each guard jumps past its arm when false; each arm but the last
+            // jumps to the end when done
+            std::vector<size_t> ends;
+            auto arms = a.items(x);
+            for (size_t i = 0; i < arms.size(); ++i) {
+                Node g = a.guard(arms[i]);
+                tmp = tmp_base;
+                size_t skip;
+                if (a.kind(g) == Kind::Bin && a.op(g) == '=') {
+                    auto l = expr(a.lhs(g)), r = expr(a.rhs(g));
+                    skip = emit(Op::JNE, l, r);
+                } else {
+                    skip = emit(Op::JZ, expr(g));
+                }
+                stmt(a.kid(arms[i]));
+                if (i + 1 < arms.size()) ends.push_back(emit(Op::JMP));
+                p.code[skip].c = uint32_t(p.code.size());
+            }
+            for (auto at : ends) p.code[at].c = uint32_t(p.code.size());
+            break;
+        }
+        case Kind::MulAdd: {
+            // JNEG n, slow; acc ±= n * e; n := 0; JMP end; slow: <loop>; end:
+            auto n = uint32_t(a.slot(a.count(x)));
+            auto slow = emit(Op::JNEG, n);
+            if (a.acc(x) != NO_NODE) emit(a.op(x) == '+' ? Op::MULADD : Op::MULSUB, a.slot(a.acc(x)), n, expr(a.step(x)));
+            emit(Op::MOV, n, const_reg.at(0));
+            auto end = emit(Op::JMP);
+            p.code[slow].c = uint32_t(p.code.size());
+            stmt(a.loop(x));
+            p.code[end].c = uint32_t(p.code.size());
+            break;
+        }
+        default: break;
+        }
+    }
+
+    // Fills in the PAR at `at` for the marked loop x just compiled from
+    // `head`: a copy of the loop's code, its exit jumps aimed at a HALT
+    void reduction(Node x, size_t at, uint32_t head) {
+        auto r = par::analyze(a, x);
+        auto end = uint32_t(p.code.size());
+        Reduce red{{}, uint32_t(a.slots[r->count]), {}, threads};
+        for (auto id : r->accs) red.accs.push_back(uint32_t(a.slots[id]));
+        for (uint32_t i = head; i < end; ++i) {
+            Instr in = p.code[i];
+            if (in.op == Op::JZ || in.op == Op::JEQ || in.op == Op::JMP || in.op == Op::JNE || in.op == Op::JNEG)
+                in.c -= head;
+            red.body.code.push_back(in);
+        }
+        red.body.code.push_back({Op::HALT});
+        red.body.terms = p.terms;
+        p.code[at] = {Op::PAR, red.count, uint32_t(p.reduces.size()), end};
+        p.reduces.push_back(std::move(red));
+    }
+
+    Program compile(const Symbols& syms) {
+        std::vector<int> lits;
+        collect(a.root, lits);
+        for (auto v : lits)
+            if (const_reg.try_emplace(v, uint32_t(syms.size() + p.consts.size())).second)
+                p.consts.emplace_back(const_reg[v], v);
+        tmp_base = uint32_t(syms.size() + p.consts.size());
+        p.nregs = tmp_base;
+        stmt(a.root);
+        emit(Op::HALT);
+        auto brk = uint32_t(emit(Op::BRKERR));
+        for (auto at : orphans) p.code[at].c = brk;
+        for (auto& red : p.reduces) red.body.nregs = p.nregs;
+        return std::move(p);
+    }
+};
+
+// `prog` must have been annotated by resolve(); variable registers are its
+// slots. With threads > 1, loops marked by par::mark run on that many threads.
+inline Program compile(const Ast& prog, const Symbols& syms, unsigned threads = 0) {
+    return Compiler{prog, threads}.compile(syms);
+}
+
+// ---------- Interpreter ----------
+
+// Initialize a register file: literals loaded, everything else zero.
+// Callers then store arguments into the arg1..argN registers.
+inline std::vector<Int> registers(const Program& p) {
+    std::vector<Int> regs(p.nregs);
+    for (auto& [r, v] : p.consts) regs[r] = v;
+    return regs;
+}
+
+// Reinitializes a register file for another run of p, keeping the storage
+// of the values in it (libe1 contexts reuse theirs)
+inline void reset(const Program& p, std::vector<Int>& regs) {
+    regs.resize(p.nregs);
+    for (auto& r : regs) r = 0;
+    for (auto& [r, v] : p.consts) regs[r] = v;
+}
+
+enum class Status { Halt, BreakErr, Hot };
+
+// Runs a PAR loop over the registers r (par::reduce); false if it declined
+inline bool reduce(const Reduce& red, Int* r);
+
+// Per-run working storage of exec(): the threaded code (handler addresses are
+// only known inside exec) and the loop budgets. A caller that runs programs
+// repeatedly passes its own (libe1 contexts do) and reuses the storage.
+struct Frame {
+    struct Threaded { const void* h; uint32_t a, b, c; };
+    std::vector<Threaded> code;
+    std::vector<uint32_t> budget;
+    uint32_t spent = 0;  // the jump whose budget ran out (Status::Hot)
+};
+
+// Runs from instruction `pc`. Counted: each backward jump (a loop iteration)
+// decrements a per-jump budget of `hot` iterations; when one runs out,
+// execution stops with Status::Hot and `pc` at that loop's head, so --tier-up
+// (e1_baseline.hpp) can continue there in native code with the same registers.
+// resume continues such a run in the same frame: the code stays threaded and
+// only the spent budget is refilled, so a slice costs nothing per instruction
+// of the program (libe1's timeouts).
+template <bool Counted = false>
+inline Status exec(const Program& p, std::vector<Int>& regs, uint32_t& pc, uint32_t hot = 0, Frame* frame = nullptr,
+                   bool resume = false) {
+    using Threaded = Frame::Threaded;
+    static const void* const labels[] = {
+        &&op_mov, &&op_add, &&op_sub, &&op_neg, &&op_addto, &&op_subfrom,
+        &&op_jz, &&op_jeq, &&op_jmp, &&op_print, &&op_halt, &&op_brkerr,
+        &&op_mul, &&op_div, &&op_mod, &&op_eq, &&op_ne, &&op_lt, &&op_gt, &&op_le, &&op_ge,
+        &&op_jne, &&op_jneg, &&op_muladd, &&op_mulsub, &&op_sum, &&op_move, &&op_par,
+    };
+    Frame own;
+    if (!frame) frame = &own;
+    auto& code = frame->code;
+    auto& budget = frame->budget;
+    if (resume) {
+        budget[frame->spent] = hot;
+    } else {
+        code.resize(p.code.size());
+        for (size_t i = 0; i < code.size(); ++i) {
+            auto& in = p.code[i];
+            code[i] = {labels[size_t(in.op)], in.a, in.b, in.c};
+        }
+        budget.assign(Counted ? code.size() : 0, hot);
+    }
+    Int* r = regs.data();
+    const Threaded* base = code.data();
+    const Threaded* ip = base + pc;
+#define NEXT() goto *(++ip)->h
+#define JUMP(t) goto *(ip = base + (t))->h
+    goto *ip->h;
+op_mov:     r[ip->a] = r[ip->b]; NEXT();
+op_add:     r[ip->a] = r[ip->b] + r[ip->c]; NEXT();
+op_sub:     r[ip->a] = r[ip->b] - r[ip->c]; NEXT();
+op_neg:     r[ip->a] = -r[ip->b]; NEXT();
+op_addto:   r[ip->a] += r[ip->b]; NEXT();
+op_subfrom: r[ip->a] -= r[ip->b]; NEXT();
+op_jz:      if (r[ip->a] == 0) JUMP(ip->c); NEXT();
+op_jeq:     if (r[ip->a] == r[ip->b]) JUMP(ip->c); NEXT();
+op_jmp:
+    if constexpr (Counted)
+        if (ip->c <= uint32_t(ip - base) && --budget[ip - base] == 0)
+            return pc = ip->c, frame->spent = uint32_t(ip - base), Status::Hot;
+    JUMP(ip->c);
+op_print:   print_int(r[ip->a]); NEXT();
+op_halt:    return Status::Halt;
+op_brkerr:  return Status::BreakErr;
+op_mul:     r[ip->a] = r[ip->b] * r[ip->c]; NEXT();
+op_div:     r[ip->a] = ediv(r[ip->b], r[ip->c]); NEXT();
+op_mod:     r[ip->a] = emod(r[ip->b], r[ip->c]); NEXT();
+op_eq:      r[ip->a] = Int(r[ip->b] == r[ip->c]); NEXT();
+op_ne:      r[ip->a] = Int(r[ip->b] != r[ip->c]); NEXT();
+op_lt:      r[ip->a] = Int(r[ip->b] < r[ip->c]); NEXT();
+op_gt:      r[ip->a] = Int(r[ip->b] > r[ip->c]); NEXT();
+op_le:      r[ip->a] = Int(r[ip->b] <= r[ip->c]); NEXT();
+op_ge:      r[ip->a] = Int(r[ip->b] >= r[ip->c]); NEXT();
+op_jne:     if (!(r[ip->a] == r[ip->b])) JUMP(ip->c); NEXT();
+op_jneg:    if (r[ip->a] < 0) JUMP(ip->c); NEXT();
+op_muladd:  mul_add(r[ip->a], '+', r[ip->b], r[ip->c]); NEXT();
+op_mulsub:  mul_add(r[ip->a], '-', r[ip->b], r[ip->c]); NEXT();
+op_sum:     sum(r[ip->a], p.terms.data() + ip->b, r); NEXT();
+op_move:    move_int(r[ip->a], r[ip->b]); NEXT();
+op_par:     if (reduce(p.reduces[ip->b], r)) JUMP(ip->c); NEXT();
+#undef NEXT
+#undef JUMP
+}
+
+// Returns false if a break_ifz (or e2 break) outside any loop fired.
+inline bool run(const Program& p, std::vector<Int>& regs, Frame* frame = nullptr) {
+    uint32_t pc = 0;
+    return exec(p, regs, pc, 0, frame) == Status::Halt;
+}
+
+inline bool reduce(const Reduce& red, Int* r) {
+    return par::reduce({r, red.body.nregs}, red.count, red.accs, red.threads,
+                       [&](unsigned, std::vector<Int>& mine) { run(red.body, mine); });
+}
+
+} // namespace vm
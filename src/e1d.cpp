@@ -0,0 +1,286 @@
+// PL/0 Levels 1-2 — e1d: execution daemon; built with -DLEVEL=2 it runs e2
+// programs (//src:e2d)
+//
+// Usage: e1d [--workers N] [--cache N] [--timeout MS] [--max-output BYTES] <socket>
+//
+// Serves run requests (a program's source and its arguments, see e1d.hpp)
+// on a Unix stream socket, so a short job costs neither a process start nor,
+// once its program has been seen, a parse. Compiled programs (libe1, VM
+// engine) are kept in an LRU cache of --cache entries (default 256) keyed by
+// a hash of the source and the request flags; runs keep a cache entry they
+// use alive after it is evicted.
+//
+// The main thread waits on the listening socket and on the connections with
+// epoll; a connection with a request to read is queued for a pool of worker
+// threads (default: one per core), and is watched again (EPOLLONESHOT) after
+// its response is sent. Each worker runs requests in its own e1_context and
+// captures their output in a buffer, up to --max-output bytes (default
+// 16 MiB). A run stops after the request's timeout, at most --timeout ms
+// (default 10000), which is also the default. SIGINT or SIGTERM stops the
+// daemon and removes the socket.
+#include "libe1.h"
+#include "e1.hpp"
+#include "e1_cache.hpp"
+#include "e1d.hpp"
+#include <algorithm>
+#include <charconv>
+#include <condition_variable>
+#include <csignal>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/un.h>
+#include <thread>
+#include <unordered_map>
+
+namespace {
+
+struct Config {
+    unsigned workers = std::max(std::thread::hardware_concurrency(), 1u);
+    size_t cache = 256;             // programs
+    uint32_t timeout_ms = 10000;    // per run, default and maximum
+    size_t max_output = 16u << 20;  // bytes per run
+};
+
+using Program = std::shared_ptr<const e1_program>;
+
+// Compiled programs by key, most recently used first
+class Programs {
+public:
+    explicit Programs(size_t capacity) : capacity_(capacity) {}
+
+    Program find(const cache::Key& k) {
+        std::lock_guard lock(m_);
+        auto it = index_.find(k);
+        if (it == index_.end()) return nullptr;
+        lru_.splice(lru_.begin(), lru_, it->second);
+        return it->second->second;
+    }
+
+    // Two workers may compile the same program at once; the later one wins
+    void insert(const cache::Key& k, Program p) {
+        std::lock_guard lock(m_);
+        if (auto it = index_.find(k); it != index_.end()) {
+            lru_.erase(it->second);
+            index_.erase(it);
+        }
+        lru_.emplace_front(k, std::move(p));
+        index_[k] = lru_.begin();
+        while (lru_.size() > capacity_) {
+            index_.erase(lru_.back().first);
+            lru_.pop_back();
+        }
+    }
+
+private:
+    struct KeyHash {
+        size_t operator()(const cache::Key& k) const { return k.lo; }
+    };
+    std::mutex m_;
+    size_t capacity_;
+    std::list<std::pair<cache::Key, Program>> lru_;
+    std::unordered_map<cache::Key, decltype(lru_)::iterator, KeyHash> index_;
+};
+
+// Connections with a request to read
+class Ready {
+public:
+    void push(int fd) {
+        {
+            std::lock_guard lock(m_);
+            fds_.push_back(fd);
+        }
+        cv_.notify_one();
+    }
+    // The next connection; nullopt once stop() was called
+    std::optional<int> pop() {
+        std::unique_lock lock(m_);
+        cv_.wait(lock, [&] { return stop_ || !fds_.empty(); });
+        if (stop_) return std::nullopt;
+        int fd = fds_.front();
+        fds_.pop_front();
+        return fd;
+    }
+    void stop() {
+        {
+            std::lock_guard lock(m_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+    }
+
+private:
+    std::mutex m_;
+    std::condition_variable cv_;
+    std::deque<int> fds_;
+    bool stop_ = false;
+};
+
+// Output of the current run, cut off at `max` bytes
+struct Capture {
+    std::string text;
+    size_t max = 0;
+    bool truncated = false;
+
+    static void append(void* user, const char* data, size_t len) {
+        auto& c = *static_cast<Capture*>(user);
+        if (c.text.size() + len > c.max) {
+            len = c.max - c.text.size();
+            c.truncated = true;
+        }
+        c.text.append(data, len);
+    }
+};
+
+// A worker's connection handling, with buffers kept from request to request
+class Worker {
+public:
+    Worker(const Config& cfg, Programs& programs) : cfg_(cfg), programs_(programs) {
+        out_.max = cfg.max_output;
+    }
+
+    // Reads one request from fd and answers it; false if the connection
+    // is to be closed
+    bool serve(int fd) {
+        e1d::RequestHeader h;
+        if (!e1d::read_all(fd, &h, sizeof h)) return false;
+        if (h.magic != e1d::RequestMagic || h.src_len > e1d::MaxPayload || h.args_len > e1d::MaxPayload ||
+            h.nargs > h.args_len)
+            return reply(fd, e1d::BadRequest, "bad request"), false;
+        src_.resize(h.src_len);
+        args_.resize(h.args_len);
+        if (!e1d::read_all(fd, src_.data(), h.src_len) || !e1d::read_all(fd, args_.data(), h.args_len)) return false;
+        argv_.clear();
+        for (size_t at = 0; at < args_.size();) {
+            size_t end = args_.find('\0', at);
+            if (end == std::string::npos) break;
+            argv_.push_back(args_.data() + at);
+            at = end + 1;
+        }
+        if (argv_.size() != h.nargs || (h.args_len && args_.back() != '\0'))
+            return reply(fd, e1d::BadRequest, "bad request"), false;
+        argv_.push_back(nullptr);
+
+        auto key = cache::hash(src_, h.flags);
+        auto prog = programs_.find(key);
+        if (!prog) {
+            e1_options opt;
+            e1_default_options(&opt);
+            opt.optimize = !(h.flags & e1d::NoOptimize);
+            e1_error err;
+            auto* p = e1_compile_with(src_.data(), src_.size(), &opt, &err);
+            if (!p) return reply(fd, e1d::ParseError, err.message);
+            prog = Program(p, e1_program_free);
+            programs_.insert(key, prog);
+        }
+
+        e1_context_set_timeout(ctx_.get(), h.timeout_ms ? std::min(h.timeout_ms, cfg_.timeout_ms) : cfg_.timeout_ms);
+        out_.text.clear();
+        out_.truncated = false;
+        int st = e1_run_in(ctx_.get(), prog.get(), argv_.data(), Capture::append, &out_);
+        if (st == E1_OK && out_.truncated) st = e1d::OutputLimit;
+        return reply(fd, st, out_.text);
+    }
+
+private:
+    bool reply(int fd, int32_t status, std::string_view payload) {
+        e1d::ResponseHeader h{e1d::ResponseMagic, status, uint32_t(payload.size())};
+        return e1d::send_all(fd, &h, sizeof h) && e1d::send_all(fd, payload.data(), payload.size());
+    }
+
+    const Config& cfg_;
+    Programs& programs_;
+    std::unique_ptr<e1_context, decltype(&e1_context_free)> ctx_{e1_context_new(), e1_context_free};
+    std::string src_, args_;
+    std::vector<char*> argv_;
+    Capture out_;
+};
+
+bool parse_count(std::string_view s, auto& n) {
+    return std::from_chars(s.data(), s.data() + s.size(), n).ec == std::errc{} && n > 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Config cfg;
+    const char* path = nullptr;
+    bool ok = true;
+    for (int i = 1; i < argc && ok; ++i) {
+        std::string_view a = argv[i];
+        if (a == "--workers" && i + 1 < argc) ok = parse_count(argv[++i], cfg.workers);
+        else if (a == "--cache" && i + 1 < argc) ok = parse_count(argv[++i], cfg.cache);
+        else if (a == "--timeout" && i + 1 < argc) ok = parse_count(argv[++i], cfg.timeout_ms);
+        else if (a == "--max-output" && i + 1 < argc) ok = parse_count(argv[++i], cfg.max_output);
+        else if (!path && !a.starts_with("-")) path = argv[i];
+        else ok = false;
+    }
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (!ok || !path || std::strlen(path) >= sizeof addr.sun_path) {
+        std::println(stderr, "Usage: {} [--workers N] [--cache N] [--timeout MS] [--max-output BYTES] <socket>", argv[0]);
+        return 1;
+    }
+    std::strcpy(addr.sun_path, path);
+
+    // SIGINT/SIGTERM arrive through a signalfd, in no thread
+    sigset_t stop_signals;
+    sigemptyset(&stop_signals);
+    sigaddset(&stop_signals, SIGINT);
+    sigaddset(&stop_signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stop_signals, nullptr);
+    int sig = signalfd(-1, &stop_signals, SFD_CLOEXEC);
+
+    int listener = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    unlink(path);
+    if (listener < 0 || bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof addr) < 0 ||
+        listen(listener, SOMAXCONN) < 0) {
+        std::println(stderr, "Error: {}: {}", path, std::strerror(errno));
+        return 1;
+    }
+    int ep = epoll_create1(EPOLL_CLOEXEC);
+    for (int fd : {listener, sig}) {
+        epoll_event ev{EPOLLIN, {.fd = fd}};
+        epoll_ctl(ep, EPOLL_CTL_ADD, fd, &ev);
+    }
+
+    Programs programs(cfg.cache);
+    Ready ready;
+    std::vector<std::jthread> pool;
+    for (unsigned w = 0; w < cfg.workers; ++w)
+        pool.emplace_back([&] {
+            Worker worker(cfg, programs);
+            while (auto fd = ready.pop()) {
+                if (worker.serve(*fd)) {
+                    epoll_event ev{EPOLLIN | EPOLLONESHOT, {.fd = *fd}};
+                    epoll_ctl(ep, EPOLL_CTL_MOD, *fd, &ev);
+                } else close(*fd);
+            }
+        });
+    std::println(stderr, "e1d: listening on {} ({} workers)", path, cfg.workers);
+
+    // A client that stops in the middle of a request holds its worker at
+    // most this long
+    timeval recv_timeout{5, 0};
+    for (bool running = true; running;) {
+        epoll_event events[64];
+        int n = epoll_wait(ep, events, 64, -1);
+        for (int i = 0; i < n; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == sig) running = false;
+            else if (fd == listener) {
+                for (int conn; (conn = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC)) >= 0;) {
+                    setsockopt(conn, SOL_SOCKET, SO_RCVTIMEO, &recv_timeout, sizeof recv_timeout);
+                    epoll_event ev{EPOLLIN | EPOLLONESHOT, {.fd = conn}};
+                    epoll_ctl(ep, EPOLL_CTL_ADD, conn, &ev);
+                }
+            } else ready.push(fd);
+        }
+    }
+    ready.stop();
+    pool.clear();
+    unlink(path);
+    return 0;
+}
@@ -0,0 +1,104 @@
+// PL/0 Levels 1-2 — e1d wire protocol (the daemon, e1d.cpp, and its
+// clients, e.g. //bench:e1d_load)
+//
+// A client connects to the daemon's Unix stream socket and sends requests
+// on it one at a time, each answered by one response before the next is
+// read. Both are a fixed header followed by a payload whose length the
+// header gives; integers are in host byte order (the socket is local).
+//
+//   request:  RequestHeader, source (src_len bytes), nargs arguments
+//             (each a decimal string ending in NUL; args_len bytes in all)
+//   response: ResponseHeader, payload (len bytes): the program's output
+//             (up to where it stopped), or for ParseError and BadRequest
+//             the error message
+//
+// The status is a libe1 run status (E1_OK, E1_BREAK_OUTSIDE_LOOP,
+// E1_INVALID_ARGUMENT, E1_FAILED, E1_TIMEOUT) or one of the daemon's below.
+// After BadRequest the daemon closes the connection.
+#pragma once
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+namespace e1d {
+
+inline constexpr uint32_t RequestMagic = 0x51523145;   // "E1RQ"
+inline constexpr uint32_t ResponseMagic = 0x53523145;  // "E1RS"
+inline constexpr uint32_t MaxPayload = 64u << 20;      // bytes, either direction
+
+enum Flags : uint32_t {
+    NoOptimize = 1,  // -O0
+};
+
+// Daemon statuses, after libe1's
+enum Status : int32_t {
+    ParseError = 16,   // the program does not compile; payload: "line:col: message"
+    OutputLimit = 17,  // output truncated at the daemon's --max-output
+    BadRequest = 18,   // malformed request
+};
+
+struct RequestHeader {
+    uint32_t magic = RequestMagic;
+    uint32_t flags = 0;
+    uint32_t timeout_ms = 0;  // 0: the daemon's default
+    uint32_t nargs = 0;
+    uint32_t src_len = 0;
+    uint32_t args_len = 0;
+};
+
+struct ResponseHeader {
+    uint32_t magic = ResponseMagic;
+    int32_t status = 0;
+    uint32_t len = 0;
+};
+
+// Reads exactly n bytes; false on end of stream or error
+inline bool read_all(int fd, void* p, size_t n) {
+    auto* c = static_cast<char*>(p);
+    while (n > 0) {
+        auto r = ::read(fd, c, n);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return false;
+        c += r;
+        n -= size_t(r);
+    }
+    return true;
+}
+
+// Writes all of p[0..n) (no SIGPIPE if the peer is gone); false on error
+inline bool send_all(int fd, const void* p, size_t n) {
+    auto* c = static_cast<const char*>(p);
+    while (n > 0) {
+        auto w = ::send(fd, c, n, MSG_NOSIGNAL);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) return false;
+        c += w;
+        n -= size_t(w);
+    }
+    return true;
+}
+
+// One encoded request
+inline std::string request(std::string_view src, const std::vector<std::string>& args, uint32_t flags = 0,
+                           uint32_t timeout_ms = 0) {
+    RequestHeader h{RequestMagic, flags, timeout_ms, uint32_t(args.size()), uint32_t(src.size()), 0};
+    for (auto& a : args) h.args_len += uint32_t(a.size() + 1);
+    std::string m(reinterpret_cast<const char*>(&h), sizeof h);
+    m.append(src);
+    for (auto& a : args) m.append(a.c_str(), a.size() + 1);
+    return m;
+}
+
+// Reads a response into `payload`; false if the connection failed
+inline bool response(int fd, ResponseHeader& h, std::string& payload) {
+    if (!read_all(fd, &h, sizeof h) || h.magic != ResponseMagic || h.len > MaxPayload) return false;
+    payload.resize(h.len);
+    return read_all(fd, payload.data(), h.len);
+}
+
+} // namespace e1d
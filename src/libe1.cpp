@@ -0,0 +1,359 @@
+// PL/0 Levels 1-2 — libe1: the C API of libe1.h over the engines
+//
+// e1_compile runs the frontend and the optimizer (through the program cache,
+// e1_cache.hpp), resolves slots and builds the code the engine shares between
+// runs and threads: bytecode for the VM, bytecode and native code for the
+// baseline JIT. Identifier spellings are copied out of the source, so the
+// program owns everything it refers to. Closures keep temporaries of their
+// own, so the closure engine's code is built per context instead, on the
+// context's first run of a program.
+//
+// A context keeps its register file, the VM's threaded code (vm::Frame) and
+// its output buffer between runs. Resetting the registers keeps the storage
+// of bigint values, and arguments are parsed into that storage, so a
+// repeated run of the VM, closure or baseline JIT engine allocates only what
+// values larger than in earlier runs need (the tree walker allocates its
+// temporaries). Output goes through the context's out::Sink when the caller
+// passes a callback.
+//
+// The tree walker (engine E1_ENGINE_AST) is defined here too; its n-ary sums
+// are flattened once, when the program is compiled (Sums).
+//
+// With opt.threads > 1, par::mark (e1_par.hpp) picks the loops the engines
+// may run on threads.
+#include "libe1.h"
+#include "e1.hpp"
+#include "e1_baseline.hpp"
+#include "e1_cache.hpp"
+#include "e1_closure.hpp"
+#include "e1_par.hpp"
+#include "e1_vm.hpp"
+#include <atomic>
+#include <chrono>
+
+// Register file indexed by resolved slot (see resolve() in e1.hpp)
+using Env = std::vector<Int>;
+
+// The tree walker's n-ary sums (sum_terms), flattened once per program: the
+// operands of a chain rooted at node n are terms[runs[n].at..][..runs[n].len]
+struct Sums {
+    struct Run { uint32_t at = 0, len = 0; };
+    std::vector<Run> runs;  // per node; len 0: not the root of a sum
+    std::vector<Addend> terms;
+};
+
+void index_sums(const Ast& a, Node n, Sums& sums, std::vector<Addend>& buf) {
+    auto index = [&](Node k) { index_sums(a, k, sums, buf); };
+    switch (a.kind(n)) {
+    case Kind::Bin:
+        if (sums.runs[n].len) break;
+        if (sum_terms(a, n, buf)) {
+            Sums::Run run{uint32_t(sums.terms.size()), uint32_t(buf.size())};
+            sums.runs[n] = run;
+            sums.terms.insert(sums.terms.end(), buf.begin(), buf.end());
+            for (uint32_t i = 0; i < run.len; i++) index(sums.terms[run.at + i].x);
+        } else {
+            index(a.lhs(n));
+            index(a.rhs(n));
+        }
+        break;
+    case Kind::Assign: case Kind::Neg: case Kind::Loop: case Kind::BreakIfz: case Kind::Print: index(a.kid(n)); break;
+    case Kind::Arm: index(a.guard(n)); index(a.kid(n)); break;
+    case Kind::Block: case Kind::Case: for (auto s : a.items(n)) index(s); break;
+    case Kind::MulAdd:
+        index(a.loop(n));
+        if (a.acc(n) != NO_NODE) index(a.step(n));
+        break;
+    default: break;
+    }
+}
+
+Sums index_sums(const Ast& a) {
+    Sums sums;
+    sums.runs.resize(a.kinds.size());
+    std::vector<Addend> buf;
+    index_sums(a, a.root, sums, buf);
+    return sums;
+}
+
+// Operands of a sum the walker evaluates per bigint::sum call (on the stack)
+constexpr uint32_t SumChunk = 8;
+
+Int eval(const Ast& a, const Sums& sums, Node e, Env& env) {
+    switch (a.kind(e)) {
+    case Kind::Num: return a.val(e);
+    case Kind::Var: return env[a.slot(e)];
+    case Kind::Neg: return -eval(a, sums, a.kid(e), env);
+    case Kind::Bin: {
+        if (auto run = sums.runs[e]; run.len) {
+            // Chunks of operands, each added to the sum so far (ts[0])
+            Int s, vals[SumChunk];
+            SumTerm ts[SumChunk + 1];
+            ts[0] = {&s, false};
+            for (uint32_t i = 0; i < run.len;) {
+                SumTerm* from = i == 0 ? ts + 1 : ts;
+                uint32_t k = 0;
+                for (; k < SumChunk && i < run.len; k++, i++) {
+                    auto [y, sub] = sums.terms[run.at + i];
+                    vals[k] = eval(a, sums, y, env);
+                    ts[k + 1] = {&vals[k], sub};
+                }
+                sum(s, from, uint32_t(ts + k + 1 - from));
+            }
+            return s;
+        }
+        Int l = eval(a, sums, a.lhs(e), env), r = eval(a, sums, a.rhs(e), env);
+        if (a.op(e) == '+') return l + r;
+        if (a.op(e) == '-') return l - r;
+        return binop(a.op(e), l, r);
+    }
+    default: return 0;
+    }
+}
+
+Flow exec(const Ast& a, const Sums& sums, Node s, Env& env, unsigned threads = 0);
+
+// A marked loop s on threads; false if par::reduce declined
+bool reduce_loop(const Ast& a, const Sums& sums, Node s, Env& env, unsigned threads) {
+    auto r = par::analyze(a, s);
+    std::vector<uint32_t> accs;
+    for (auto id : r->accs) accs.push_back(uint32_t(a.slots[id]));
+    return par::reduce(env, uint32_t(a.slots[r->count]), accs, threads, [&](unsigned, Env& mine) {
+        while (exec(a, sums, a.kid(s), mine) == Flow::Next) {}
+    });
+}
+
+// threads > 1: marked loops run on that many threads
+Flow exec(const Ast& a, const Sums& sums, Node s, Env& env, unsigned threads) {
+    switch (a.kind(s)) {
+    case Kind::Assign: {
+        char op;
+        if (a.op(s) == 'm') move_int(env[a.slot(s)], env[a.slot(a.kid(s))]);
+        else if (Node d = self_update(a, s, &op); d != NO_NODE) {
+            if (op == '+') env[a.slot(s)] += eval(a, sums, d, env);
+            else env[a.slot(s)] -= eval(a, sums, d, env);
+        } else env[a.slot(s)] = eval(a, sums, a.kid(s), env);
+        break;
+    }
+    case Kind::Block:
+        for (auto st : a.items(s))
+            if (exec(a, sums, st, env, threads) == Flow::Break) return Flow::Break;
+        break;
+    case Kind::Loop:
+        if (a.op(s) == 'p' && threads > 1 && reduce_loop(a, sums, s, env, threads)) break;
+        while (exec(a, sums, a.kid(s), env, threads) == Flow::Next) {}
+        break;
+    case Kind::BreakIfz: if (eval(a, sums, a.kid(s), env) == 0) return Flow::Break; break;
+    case Kind::Print: print_int(eval(a, sums, a.kid(s), env)); break;
+    case Kind::Break: return Flow::Break;
+    case Kind::Case:
+        for (auto arm : a.items(s))
+            if (!(eval(a, sums, a.guard(arm), env) == 0)) return exec(a, sums, a.kid(arm), env, threads);
+        break;
+    case Kind::MulAdd: {
+        Int& n = env[a.slot(a.count(s))];
+        if (n < 0) return exec(a, sums, a.loop(s), env, threads);
+        if (a.acc(s) != NO_NODE) mul_add(env[a.slot(a.acc(s))], a.op(s), n, eval(a, sums, a.step(s), env));
+        n = 0;
+        break;
+    }
+    default: break;  // Decl: nothing to do, every slot starts at 0
+    }
+    return Flow::Next;
+}
+
+struct e1_program {
+    uint64_t id = 0;  // tells programs apart in contexts (addresses are reused)
+    e1_options opt;
+    Ast ast;
+    std::string names;  // the identifier spellings `ast` views
+    Symbols syms;
+    Sums sums;                               // tree walker
+    vm::Program code;                        // VM and baseline JIT
+    std::unique_ptr<baseline::Code> native;  // baseline JIT
+};
+
+struct e1_context {
+    Env regs;
+    vm::Frame frame;
+    unsigned timeout_ms = 0;
+    uint64_t closure_for = 0;  // id of the program `closure` was built for
+    closure::StmtFn closure;
+    out::Sink sink;
+};
+
+namespace {
+
+// Points the spellings at a copy in `names`, so the source can go away
+void own_names(Ast& a, std::string& names) {
+    size_t total = 0;
+    for (auto s : a.spellings) total += s.size();
+    names.reserve(total);
+    for (auto& s : a.spellings) {
+        size_t at = names.size();
+        names.append(s);
+        s = std::string_view(names).substr(at, s.size());
+    }
+}
+
+e1_program* fail(e1_error* err, std::string_view msg) {
+    if (err) {
+        size_t n = std::min(msg.size(), sizeof err->message - 1);
+        std::memcpy(err->message, msg.data(), n);
+        err->message[n] = '\0';
+    }
+    return nullptr;
+}
+
+// Sets r to the argument s (nullptr: 0), reusing r's storage
+void set_arg(Int& r, const char* s) {
+    if (!s) r = 0;
+#if INT_BITS == 0
+    else r.set_str(s);
+#else
+    else r = std::atoll(s);
+#endif
+}
+
+// Loop iterations the VM runs between two looks at the clock (per loop)
+constexpr uint32_t TimeSlice = 4096;
+
+// A VM run with a time limit: counted slices (see vm::exec), each resuming
+// at the loop head where the previous one stopped, in the code the first
+// slice threaded
+int run_until(e1_context& ctx, const vm::Program& code) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(ctx.timeout_ms);
+    uint32_t pc = 0;
+    for (bool resume = false;; resume = true) {
+        auto st = vm::exec<true>(code, ctx.regs, pc, TimeSlice, &ctx.frame, resume);
+        if (st != vm::Status::Hot) return st == vm::Status::Halt ? E1_OK : E1_BREAK_OUTSIDE_LOOP;
+        if (std::chrono::steady_clock::now() >= deadline) return E1_TIMEOUT;
+    }
+}
+
+int run(e1_context& ctx, const e1_program& p) {
+    auto& regs = ctx.regs;
+    auto status = [](bool ok) { return ok ? E1_OK : E1_BREAK_OUTSIDE_LOOP; };
+    switch (p.opt.engine) {
+    case E1_ENGINE_AST: return status(exec(p.ast, p.sums, p.ast.root, regs, p.opt.threads) == Flow::Next);
+    case E1_ENGINE_CLOSURE:
+        if (ctx.closure_for != p.id) {
+            ctx.closure = closure::compile(p.ast, p.opt.threads);
+            ctx.closure_for = p.id;
+        }
+        return status(closure::run(ctx.closure, regs.data()));
+    case E1_ENGINE_BASELINE_JIT: {
+        uint32_t pc = 0;
+        auto st = p.opt.tier_up ? vm::exec<true>(p.code, regs, pc, p.opt.tier_up, &ctx.frame) : vm::Status::Hot;
+        if (st == vm::Status::Hot) return status(p.native->run(regs, pc));
+        return status(st == vm::Status::Halt);
+    }
+    default:
+        if (ctx.timeout_ms) return run_until(ctx, p.code);
+        return status(vm::run(p.code, regs, &ctx.frame));
+    }
+}
+
+thread_local e1_context this_thread;  // e1_run's context
+
+} // namespace
+
+extern "C" {
+
+void e1_default_options(e1_options* opt) { *opt = {E1_ENGINE_VM, 1, 0, 0, 0}; }
+
+e1_program* e1_compile(const char* src, size_t len, e1_error* err) {
+    e1_options opt;
+    e1_default_options(&opt);
+    return e1_compile_with(src, len, &opt, err);
+}
+
+e1_program* e1_compile_with(const char* src, size_t len, const e1_options* opt, e1_error* err) {
+    static std::atomic<uint64_t> ids;
+    if (opt->engine < E1_ENGINE_VM || opt->engine > E1_ENGINE_BASELINE_JIT) return fail(err, "unknown engine");
+    try {
+        auto p = std::make_unique<e1_program>();
+        p->id = ++ids;
+        p->opt = *opt;
+        cache::Entry entry;
+        auto ast = cache::program(std::string_view(src, len), opt->optimize, entry);
+        if (!ast) return fail(err, ast.error());
+        p->ast = std::move(*ast);
+        own_names(p->ast, p->names);
+        p->syms = resolve(p->ast);
+        if (opt->threads > 1) par::mark(p->ast);
+        if (opt->engine == E1_ENGINE_AST) p->sums = index_sums(p->ast);
+        if (opt->engine == E1_ENGINE_VM || opt->engine == E1_ENGINE_BASELINE_JIT)
+            p->code = vm::compile(p->ast, p->syms, opt->threads);
+        if (opt->engine == E1_ENGINE_BASELINE_JIT) {
+            auto native = baseline::translate(p->code);
+            if (!native) return fail(err, "baseline-jit: " + native.error());
+            p->native = std::move(*native);
+        }
+        return p.release();
+    } catch (const std::bad_alloc&) {
+        return fail(err, "out of memory");
+    }
+}
+
+void e1_program_free(e1_program* prog) { delete prog; }
+
+e1_context* e1_context_new(void) { return new (std::nothrow) e1_context; }
+void e1_context_free(e1_context* ctx) { delete ctx; }
+void e1_context_set_timeout(e1_context* ctx, unsigned ms) { ctx->timeout_ms = ms; }
+
+int e1_run(const e1_program* prog, const char* const* args, e1_output_fn out, void* user_data) {
+    return e1_run_in(&this_thread, prog, args, out, user_data);
+}
+
+int e1_run_in(e1_context* ctx, const e1_program* prog, const char* const* args, e1_output_fn out,
+              void* user_data) {
+    const char* argv[ARG_COUNT] = {};
+    for (int i = 0; args && args[i] && i < ARG_COUNT; ++i) {
+        if (bigint::bad_digit(args[i])) return E1_INVALID_ARGUMENT;
+        argv[i] = args[i];
+    }
+    try {
+        auto& regs = ctx->regs;
+        if (prog->opt.engine == E1_ENGINE_VM || prog->opt.engine == E1_ENGINE_BASELINE_JIT) {
+            vm::reset(prog->code, regs);
+        } else {
+            regs.resize(prog->syms.size());
+            for (auto& r : regs) r = 0;
+        }
+        for (int i = 0; i < ARG_COUNT; ++i) set_arg(regs[i], argv[i]);
+        if (out) {
+            ctx->sink.fn = out;
+            ctx->sink.user = user_data;
+            out::sink = &ctx->sink;
+        } else out::unbuffered = prog->opt.unbuffered;
+        int st = run(*ctx, *prog);
+        if (out) {
+            ctx->sink.flush();
+            out::sink = nullptr;
+        }
+        return st;
+    } catch (const std::bad_alloc&) {
+        ctx->sink.buf.clear();
+        out::sink = nullptr;
+        return E1_FAILED;
+    }
+}
+
+const char* e1_status_message(int status) {
+    switch (status) {
+    case E1_OK: return "ok";
+    // same wording as e2peg for e2
+    case E1_BREAK_OUTSIDE_LOOP:
+        return LEVEL >= 2 ? "Error: 'break' used outside of loop" : "Error: break_ifz outside loop";
+    case E1_INVALID_ARGUMENT: return "Error: invalid integer argument";
+    case E1_TIMEOUT: return "Error: timeout";
+    default: return "Error: out of memory";
+    }
+}
+
+int e1_arg_count(void) { return ARG_COUNT; }
+
+void e1_flush(void) { out::flush(); }
+
+} // extern "C"
@@ -0,0 +1,117 @@
+/* PL/0 Levels 1-2 — libe1: the interpreter as a library (//src:libe1)
+ *
+ * A C API for running e1 programs inside another process instead of
+ * spawning //src:e1 and capturing its stdout:
+ *
+ *   e1_error err;
+ *   e1_program* p = e1_compile(src, len, &err);   // parse, optimize, compile
+ *   const char* args[] = {"1", "30", NULL};
+ *   int st = e1_run(p, args, on_output, user);   // as often as needed
+ *   e1_program_free(p);
+ *
+ * A program is immutable once compiled and may be run from any number of
+ * threads at once. Runs need an execution context (register file, engine
+ * state, output buffer), which is kept between runs, so repeating a run
+ * reuses its storage instead of allocating it again. e1_run uses one
+ * context per calling thread; e1_run_in takes an explicit one, which must
+ * not be used by two threads at the same time.
+ *
+ * Output is collected in the context and handed to the callback in chunks
+ * (when the buffer fills and when the run ends). Without a callback it goes
+ * to stdout through the process's shared output buffer, as the e1 binary
+ * does; such runs must not overlap, and e1_flush() writes out what is left.
+ *
+ * The integer configuration (LEVEL, INT_BITS, LIMB_BITS) is fixed when the
+ * library is built: //src:libe1 is e1 with bigints, //src:libe2 is e2. With
+ * $E1_CACHE_DIR set, compiled programs are cached as for the e1 binary.
+ */
+#ifndef LIBE1_H
+#define LIBE1_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define E1_API_VERSION 2
+
+typedef struct e1_program e1_program;
+typedef struct e1_context e1_context;
+
+/* Why e1_compile failed: "line:col: message" for parse errors */
+typedef struct e1_error {
+    char message[256];
+} e1_error;
+
+typedef enum e1_engine {
+    E1_ENGINE_VM = 0,           /* bytecode VM (default) */
+    E1_ENGINE_CLOSURE = 1,      /* closure compiler */
+    E1_ENGINE_AST = 2,          /* tree walker */
+    E1_ENGINE_BASELINE_JIT = 3, /* copy-and-patch native code (x86-64 Linux) */
+} e1_engine;
+
+typedef struct e1_options {
+    e1_engine engine;
+    int optimize;        /* AST optimizer (-O1); 0 for -O0 */
+    unsigned tier_up;    /* baseline JIT: start in the VM, move a loop to native
+                            code after this many iterations; 0: native at once */
+    int unbuffered;      /* runs without a callback write every line at once */
+    unsigned threads;    /* loops that only count down and add to accumulators
+                            (e1 --parallel) run on up to this many threads,
+                            with the sequential result; 0 or 1: none do */
+} e1_options;
+
+/* Status of a run */
+enum {
+    E1_OK = 0,
+    E1_BREAK_OUTSIDE_LOOP = 1, /* a break escaped every loop; the run stopped there */
+    E1_INVALID_ARGUMENT = 2,   /* an argument is not a decimal integer; nothing ran */
+    E1_FAILED = 3,             /* out of memory or another internal error */
+    E1_TIMEOUT = 4,            /* the context's time limit ran out; the run stopped there */
+};
+
+/* Receives output: len bytes of whole lines */
+typedef void (*e1_output_fn)(void* user_data, const char* data, size_t len);
+
+/* VM engine, optimizer on, buffered, sequential */
+void e1_default_options(e1_options* opt);
+
+/* Compiles src[0..len) (which need not outlive the program). Returns NULL
+   and fills *err (if not NULL) when the program does not parse. */
+e1_program* e1_compile(const char* src, size_t len, e1_error* err);
+e1_program* e1_compile_with(const char* src, size_t len, const e1_options* opt, e1_error* err);
+void e1_program_free(e1_program* prog);
+
+e1_context* e1_context_new(void);
+void e1_context_free(e1_context* ctx);
+
+/* Runs in ctx stop with E1_TIMEOUT after ms milliseconds (0, the default:
+   no limit). The VM engine checks the clock every few thousand loop
+   iterations, except inside a loop running on threads; the other engines
+   run to the end. */
+void e1_context_set_timeout(e1_context* ctx, unsigned ms);
+
+/* Runs prog with args: arg1, arg2, ... as decimal strings, terminated by
+   NULL (args itself may be NULL); missing arguments are 0. Output goes to
+   out(user_data, ...), or to stdout if out is NULL; out must not start a run
+   in the same context (for e1_run: on the same thread). Returns an E1_
+   status. */
+int e1_run(const e1_program* prog, const char* const* args, e1_output_fn out, void* user_data);
+int e1_run_in(e1_context* ctx, const e1_program* prog, const char* const* args, e1_output_fn out,
+              void* user_data);
+
+/* The message for a status: for E1_BREAK_OUTSIDE_LOOP the one e1 prints */
+const char* e1_status_message(int status);
+
+/* Number of argument variables (arg1..argN) */
+int e1_arg_count(void);
+
+/* Writes out what runs without a callback left in the stdout buffer */
+void e1_flush(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBE1_H */
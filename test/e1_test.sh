@@ -24,6 +24,10 @@ check() {
 E1="$1"
 E1_COMPILE="$2"
 EXAMPLES="$3"
+HYBRID_CPP="$4"   # //examples:factorial_hybrid_cpp
+HYBRID_LLVM="$5"  # //examples:factorial_hybrid_llvm
+PARALLEL_CPP="$6"         # //examples:factorial_parallel_cpp
+HYBRID_PARALLEL_CPP="$7"  # //examples:factorial_hybrid_parallel_cpp
 
 # Test interpreter
 check "example_e0 interp" "$E1 $EXAMPLES/example.e0" "$(printf '7\n1\n8')"
@@ -31,6 +35,213 @@ check "factorial interp" "$E1 $EXAMPLES/factorial.e1 1 5" "120"
 check "collatz interp" "$E1 $EXAMPLES/collatz.e1 5" "$(printf '5\n16\n8\n4\n2\n1')"
 check "gcd interp" "$E1 $EXAMPLES/gcd.e1 48 18" "6"
 
+# Tree-walking engine (the default above is the bytecode VM)
+check "factorial interp (ast)" "$E1 --engine=ast $EXAMPLES/factorial.e1 1 5" "120"
+check "collatz interp (ast)" "$E1 --engine=ast $EXAMPLES/collatz.e1 5" "$(printf '5\n16\n8\n4\n2\n1')"
+check "gcd interp (ast)" "$E1 --engine=ast $EXAMPLES/gcd.e1 48 18" "6"
+
+# Closure-compiled engine
+check "factorial interp (closure)" "$E1 --engine=closure $EXAMPLES/factorial.e1 1 5" "120"
+check "collatz interp (closure)" "$E1 --engine=closure $EXAMPLES/collatz.e1 5" "$(printf '5\n16\n8\n4\n2\n1')"
+check "gcd interp (closure)" "$E1 --engine=closure $EXAMPLES/gcd.e1 48 18" "6"
+
+# Copy-and-patch baseline JIT, from the start and tiered up from the VM
+for mode in "" " --tier-up=1"; do
+    check "factorial (baseline-jit$mode)" "$E1 --engine=baseline-jit$mode $EXAMPLES/factorial.e1 1 5" "120"
+    check "collatz (baseline-jit$mode)" "$E1 --engine=baseline-jit$mode $EXAMPLES/collatz.e1 5" "$(printf '5\n16\n8\n4\n2\n1')"
+    check "gcd (baseline-jit$mode)" "$E1 --engine=baseline-jit$mode $EXAMPLES/gcd.e1 48 18" "6"
+done
+
+# Without the AST optimizer
+check "factorial interp (-O0)" "$E1 -O0 $EXAMPLES/factorial.e1 1 5" "120"
+check "collatz interp (-O0, ast)" "$E1 -O0 --engine=ast $EXAMPLES/collatz.e1 5" "$(printf '5\n16\n8\n4\n2\n1')"
+
+# Unbuffered output (every line written immediately) gives the same result
+check "collatz interp (unbuffered)" "$E1 --unbuffered $EXAMPLES/collatz.e1 5" "$(printf '5\n16\n8\n4\n2\n1')"
+
+# Bigint arguments: gcd(x, x) = x round-trips a long literal through from_str and print
+BIG=$(printf '1234567890%.0s' $(seq 1 200))
+check "gcd bigint args" "$E1 $EXAMPLES/gcd.e1 $BIG $BIG" "$BIG"
+
+# Counted accumulation loops become one multiply-add (e1_opt.hpp):
+# same result as the loops themselves (-O0), count left at 0
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+cat > "$TMP/muladd.e1" <<'E1SRC'
+n := 12
+loop { break_ifz n  acc := acc + arg1  n := n - 1 }
+n := 3
+loop { break_ifz n  n := n - 1  acc := acc - arg1 }
+print acc
+print n
+E1SRC
+for engine in vm closure ast baseline-jit; do
+    check "counted loop ($engine)" "$E1 --engine=$engine $TMP/muladd.e1 $BIG" "$($E1 -O0 $TMP/muladd.e1 $BIG)"
+done
+
+# Chains of + and - are one n-ary sum (sum_terms), also when the sum is
+# negative or the target is one of its operands
+cat > "$TMP/sum.e1" <<'E1SRC'
+print arg1 + arg1 + arg1 - arg2 + 1
+print 0 - arg1 - arg2 - (arg1 - arg2 + -arg1)
+x := x + arg1 + arg1
+x := x + arg1 + arg1
+print x - arg1 - arg1 - arg1 - arg1
+E1SRC
+SUM3="$(printf '3703703670%.0s' $(seq 1 199))3703703664"  # 3 * BIG - 6
+for engine in vm closure ast baseline-jit; do
+    check "n-ary sum ($engine)" "$E1 --engine=$engine $TMP/sum.e1 $BIG 7" "$(printf '%s\n-%s\n0' "$SUM3" "$BIG")"
+done
+
+# `x := y` with y dead afterwards moves y's value (mark_moves); a y that is
+# read again, also by the next iteration of a loop, is still copied
+cat > "$TMP/move.e1" <<'E1SRC'
+a := arg1 + arg1
+b := a
+c := b
+b := a + c
+print b
+k := 3
+loop { break_ifz k  y := x  x := y + arg1  z := x  k := k - 1 }
+print x
+print z
+print c
+E1SRC
+for engine in vm closure ast baseline-jit; do
+    check "move assignment ($engine)" "$E1 --engine=$engine $TMP/move.e1 1000000000000000000000" \
+        "$(printf '4000000000000000000000\n3000000000000000000000\n3000000000000000000000\n2000000000000000000000')"
+done
+if $E1_COMPILE $EXAMPLES/factorial.e1 | grep -q 'MOVE(result, product)' &&
+   ! $E1_COMPILE $EXAMPLES/factorial.e1 | grep -q 'MOVE(n,'; then
+    echo "PASS move emit"
+    pass=$((pass+1))
+else
+    echo "FAIL move emit"
+    fail=$((fail+1))
+fi
+
+# Loops that only count down and add to accumulators run on threads with
+# --parallel (e1_par.hpp), giving the sequential result; a loop whose
+# variables carry over from one iteration to the next stays sequential
+cat > "$TMP/par.e1" <<'E1SRC'
+k := arg1
+loop { break_ifz k  j := 5  loop { break_ifz j  s := s + j + arg2  d := d - 2  j := j - 1 }  s := s - 1  k := k - 1 }
+print s
+print d
+k := arg1
+loop { break_ifz k  z := arg2 - z  t := t + z  k := k - 1 }
+print t
+E1SRC
+for engine in vm closure ast baseline-jit; do
+    check "factorial parallel ($engine)" "$E1 --engine=$engine --parallel=4 $EXAMPLES/factorial.e1 37 25" "$($E1 $EXAMPLES/factorial.e1 37 25)"
+    check "reduction parallel ($engine)" "$E1 --engine=$engine --parallel=3 $TMP/par.e1 10 $BIG" "$($E1 $TMP/par.e1 10 $BIG)"
+done
+if $E1_COMPILE --parallel $EXAMPLES/factorial.e1 | grep -q 'std::jthread' &&
+   ! $E1_COMPILE $EXAMPLES/factorial.e1 | grep -q 'std::jthread' &&
+   [ "$($E1_COMPILE --parallel $TMP/par.e1 | grep -c 'par_workers.emplace_back')" = 1 ]; then
+    echo "PASS parallel emit"
+    pass=$((pass+1))
+else
+    echo "FAIL parallel emit"
+    fail=$((fail+1))
+fi
+# ... and the emitted workers compile and run to the same sums (1 and 3
+# iterations: sequential and fewer workers than --parallel=4)
+for n in "37 25" "3 25" "1 5"; do
+    check "factorial $n (parallel cpp)" "$PARALLEL_CPP $n" "$($E1 $EXAMPLES/factorial.e1 $n)"
+    check "factorial $n (hybrid parallel cpp)" "$HYBRID_PARALLEL_CPP $n" "$($E1 $EXAMPLES/factorial.e1 $n)"
+done
+
+# A negative count never reaches zero: the loop must still run forever
+printf 'print 1\nn := 0 - 3\nloop { break_ifz n  acc := acc + 2  n := n - 1 }\nprint acc\n' > "$TMP/neg.e1"
+rc=0
+out=$(timeout 1 $E1 --unbuffered $TMP/neg.e1) || rc=$?
+if [ $rc -eq 124 ] && [ "$out" = "1" ]; then
+    echo "PASS counted loop (negative count)"
+    pass=$((pass+1))
+else
+    echo "FAIL counted loop (negative count)"
+    fail=$((fail+1))
+fi
+
+# Hybrid code: overflow-checked int64 arithmetic in both backends
+if $E1_COMPILE --hybrid $EXAMPLES/factorial.e1 | grep -q 'hybrid::Num' &&
+   $E1_COMPILE --hybrid --llvm $EXAMPLES/factorial.e1 | grep -q '@llvm.sadd.with.overflow.i64'; then
+    echo "PASS hybrid emit"
+    pass=$((pass+1))
+else
+    echo "FAIL hybrid emit"
+    fail=$((fail+1))
+fi
+# ... and the compiled hybrid factorial matches bigint once the product
+# overflows int64 (25! and 30! do), as it does below it
+for n in "1 20" "1 30" "3 25"; do
+    check "factorial $n (hybrid cpp)" "$HYBRID_CPP $n" "$($E1 $EXAMPLES/factorial.e1 $n)"
+    check "factorial $n (hybrid llvm)" "$HYBRID_LLVM $n" "$($E1 $EXAMPLES/factorial.e1 $n)"
+done
+
+# Malformed arguments are rejected instead of parsed as garbage
+if $E1 $EXAMPLES/gcd.e1 48 1x8 > /dev/null 2>&1; then
+    echo "FAIL invalid arg (accepted)"
+    fail=$((fail+1))
+else
+    echo "PASS invalid arg"
+    pass=$((pass+1))
+fi
+
+# Parse errors carry line and column
+printf 'x := 1\nprint (x +\n  y @ 2)\n' > "$TMP/bad.e1"
+out=$($E1 "$TMP/bad.e1" 2>&1) || true
+if [ "$out" = "Error: 3:5: Unknown char: @" ]; then
+    echo "PASS parse error position"
+    pass=$((pass+1))
+else
+    echo "FAIL parse error position: $out"
+    fail=$((fail+1))
+fi
+
+# Batch mode: one row per argument set, output tagged with the row number in
+# input order whatever the number of workers
+printf 'arg1,arg2\n1,5\n\n 48 , 18\n1\n' > "$TMP/in.csv"
+for engine in vm closure ast baseline-jit; do
+    check "factorial batch ($engine)" "$E1 --engine=$engine --batch $TMP/in.csv --jobs 3 $EXAMPLES/factorial.e1 | cut -d, -f2" \
+        "$(printf '120\n%s\n1' "$($E1 $EXAMPLES/factorial.e1 48 18)")"
+done
+if [ "$($E1 --batch $TMP/in.csv --jobs 2 $EXAMPLES/gcd.e1)" = "$(printf '1,1\n2,6\n3,1')" ] &&
+   printf '1,2\n3,x\n' > "$TMP/bad.csv" && ! $E1 --batch $TMP/bad.csv $EXAMPLES/gcd.e1 > /dev/null 2>&1; then
+    echo "PASS batch rows"
+    pass=$((pass+1))
+else
+    echo "FAIL batch rows"
+    fail=$((fail+1))
+fi
+
+# Program cache: the second run and compile come from $E1_CACHE_DIR
+export E1_CACHE_DIR="$TMP/cache"
+check "factorial (cache miss)" "$E1 $EXAMPLES/factorial.e1 1 5" "120"
+check "factorial (cache hit)" "$E1 --engine=closure $EXAMPLES/factorial.e1 1 5" "120"
+cold=$($E1_COMPILE --llvm $EXAMPLES/factorial.e1)
+warm=$($E1_COMPILE --llvm $EXAMPLES/factorial.e1)
+stats=$($E1 --cache-stats)
+if [ "$cold" = "$warm" ] && [ "$warm" = "$(E1_CACHE_DIR= $E1_COMPILE --llvm $EXAMPLES/factorial.e1)" ] &&
+   [ "$stats" = "$E1_CACHE_DIR: 2 hits, 2 misses, 2 entries, $(cat "$E1_CACHE_DIR"/*.e1c | wc -c) bytes (limit 268435456)" ]; then
+    echo "PASS program cache"
+    pass=$((pass+1))
+else
+    echo "FAIL program cache: $stats"
+    fail=$((fail+1))
+fi
+unset E1_CACHE_DIR
+
+# --jit needs the LLVM-linked build (//src:e1_jit)
+if $E1 --jit $EXAMPLES/factorial.e1 > /dev/null 2>&1; then
+    echo "FAIL --jit without E1_JIT (accepted)"
+    fail=$((fail+1))
+else
+    echo "PASS --jit without E1_JIT"
+    pass=$((pass+1))
+fi
+
 echo ""
 echo "Results: $pass passed, $fail failed"
 [ $fail -eq 0 ]
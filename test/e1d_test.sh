@@ -0,0 +1,70 @@
+#!/bin/bash
+set -e
+
+pass=0
+fail=0
+
+check() {
+    name="$1"
+    cmd="$2"
+    expected="$3"
+
+    actual=$(eval "$cmd" 2>/dev/null) || true
+    if [ "$actual" = "$expected" ]; then
+        echo "PASS $name"
+        pass=$((pass+1))
+    else
+        echo "FAIL $name"
+        printf "  expected: %s\n" "$expected"
+        printf "  actual: %s\n" "$actual"
+        fail=$((fail+1))
+    fi
+}
+
+E1D="$1"
+LOAD="$2"
+EXAMPLES="$3"
+
+TMP=$(mktemp -d)
+SOCK="$TMP/e1d.sock"
+$E1D --workers 2 --cache 2 --timeout 2000 --max-output 16 "$SOCK" 2> "$TMP/log" &
+DAEMON=$!
+trap 'kill $DAEMON 2>/dev/null; rm -rf "$TMP"' EXIT
+for i in $(seq 50); do [ -S "$SOCK" ] && break; sleep 0.1; done
+
+# Output of the first response; the status shows in the exit code
+run() { $LOAD --clients 1 --requests 1 "$@"; }
+
+check "factorial" "run $SOCK $EXAMPLES/factorial.e1 1 5" "120"
+check "gcd" "run $SOCK $EXAMPLES/gcd.e1 48 18" "6"
+check "example_e0 (-O0)" "run -O0 $SOCK $EXAMPLES/example.e0" "$(printf '7\n1\n8')"
+# More programs than cache entries: evicted ones are compiled again
+check "collatz (after eviction)" "run $SOCK $EXAMPLES/collatz.e1 5" "$(printf '5\n16\n8\n4\n2\n1')"
+check "factorial (after eviction)" "run $SOCK $EXAMPLES/factorial.e1 1 5" "120"
+
+# Concurrent clients all get their answers
+check "factorial (4 clients)" "$LOAD --clients 4 --requests 200 $SOCK $EXAMPLES/factorial.e1 1 15" "1307674368000"
+
+# Errors are statuses of the request; the daemon keeps serving
+printf 'x := 1\nprint (x +\n  y @ 2)\n' > "$TMP/bad.e1"
+check "parse error" "run $SOCK $TMP/bad.e1" "3:5: Unknown char: @"
+printf 'print 1\nloop { x := x + 1 }\n' > "$TMP/forever.e1"
+check "timeout" "run --timeout 100 $SOCK $TMP/forever.e1 && echo finished" "1"
+check "output limit" "run $SOCK $EXAMPLES/collatz.e1 27 && echo finished" "$(printf '27\n82\n41\n124\n62')"
+check "invalid argument" "run $SOCK $EXAMPLES/gcd.e1 4x 2 || echo failed" "failed"
+check "still serving" "run $SOCK $EXAMPLES/gcd.e1 48 18" "6"
+
+# SIGTERM stops the daemon and removes the socket
+kill $DAEMON
+wait $DAEMON || true
+if [ ! -e "$SOCK" ]; then
+    echo "PASS shutdown"
+    pass=$((pass+1))
+else
+    echo "FAIL shutdown"
+    fail=$((fail+1))
+fi
+
+echo ""
+echo "Results: $pass passed, $fail failed"
+[ $fail -eq 0 ]
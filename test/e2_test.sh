@@ -0,0 +1,108 @@
+#!/bin/bash
+set -e
+
+pass=0
+fail=0
+
+check() {
+    name="$1"
+    cmd="$2"
+    expected="$3"
+    
+    actual=$(eval "$cmd" 2>&1 | grep -E "^-?[0-9]+$") || { echo "FAIL $name (error)"; fail=$((fail+1)); return; }
+    if [ "$actual" = "$expected" ]; then
+        echo "PASS $name"
+        pass=$((pass+1))
+    else
+        echo "FAIL $name"
+        printf "  expected: %s\n" "$expected"
+        printf "  actual: %s\n" "$actual"
+        fail=$((fail+1))
+    fi
+}
+
+E2="$1"
+E2_COMPILE="$2"
+EXAMPLES="$3"
+
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+
+# Division is Euclidean (0 <= a % b < |b|) and x / 0 = x % 0 = 0, as in e2peg;
+# comparisons yield 1 or 0
+cat > "$TMP/arith.e2" <<'E2SRC'
+print -7 / 2
+print -7 % 2
+print 7 / -2
+print -7 % -2
+print 7 / 0
+print 7 % 0
+print (2 < 3) + (3 <= 3) + (3 != 3)
+E2SRC
+ARITH="$(printf -- '-4\n1\n-3\n1\n0\n0\n2')"
+
+# Bigint multiply/divide: (x·x + 5) / x = x and (x·x + 5) % x = 5
+cat > "$TMP/big.e2" <<'E2SRC'
+y := arg1 * arg1 + 5
+print y / arg1
+print y % arg1
+E2SRC
+BIG=$(printf '1234567890%.0s' $(seq 1 200))
+
+# Optimizer: y folds to 42, the stores to x and w are dead (see e1_opt.hpp)
+cat > "$TMP/opt.e2" <<'E2SRC'
+x := 6
+y := x * 7
+x := 100
+print y
+z := arg1
+loop {
+    case { z == 0 -> break }
+    print z % 10
+    z := z / 10
+    w := z * 1000
+}
+E2SRC
+OPT="$(printf '42\n3\n2\n1')"
+
+for engine in vm closure ast baseline-jit; do
+    check "factorial ($engine)" "$E2 --engine=$engine $EXAMPLES/factorial.e2 1 30" "265252859812191058636308480000000"
+    check "collatz ($engine)" "$E2 --engine=$engine $EXAMPLES/collatz.e2 5" "$(printf '5\n16\n8\n4\n2\n1')"
+    check "gcd ($engine)" "$E2 --engine=$engine $EXAMPLES/gcd.e2 48 18" "6"
+    check "arithmetic ($engine)" "$E2 --engine=$engine $TMP/arith.e2" "$ARITH"
+    check "bigint mul/div ($engine)" "$E2 --engine=$engine $TMP/big.e2 $BIG" "$(printf '%s\n5' "$BIG")"
+    check "optimizer -O1 ($engine)" "$E2 --engine=$engine $TMP/opt.e2 123" "$OPT"
+    check "optimizer -O0 ($engine)" "$E2 --engine=$engine -O0 $TMP/opt.e2 123" "$OPT"
+done
+check "factorial (baseline-jit --tier-up=1)" "$E2 --engine=baseline-jit --tier-up=1 $EXAMPLES/factorial.e2 1 30" "265252859812191058636308480000000"
+check "collatz (baseline-jit --tier-up=1)" "$E2 --engine=baseline-jit --tier-up=1 $EXAMPLES/collatz.e2 5" "$(printf '5\n16\n8\n4\n2\n1')"
+
+# The countdown loop of factorial.e2 runs on threads with --parallel
+for engine in vm closure ast baseline-jit; do
+    check "factorial parallel ($engine)" "$E2 --engine=$engine --parallel=4 $EXAMPLES/factorial.e2 37 25" "$($E2 $EXAMPLES/factorial.e2 37 25)"
+done
+
+# With -O1 no multiplication survives in the emitted code
+if $E2_COMPILE "$TMP/opt.e2" | sed -n '/^int main/,$p' | grep -q 'MUL('; then
+    echo "FAIL optimizer emit (MUL left in)"
+    fail=$((fail+1))
+else
+    echo "PASS optimizer emit"
+    pass=$((pass+1))
+fi
+
+# Both backends must accept every example
+for f in "$EXAMPLES"/*.e2; do
+    for backend in "" --llvm --hybrid "--llvm --hybrid"; do
+        if $E2_COMPILE $backend "$f" > /dev/null 2>&1; then
+            pass=$((pass+1))
+        else
+            echo "FAIL compile $backend $(basename "$f")"
+            fail=$((fail+1))
+        fi
+    done
+done
+
+echo ""
+echo "Results: $pass passed, $fail failed"
+[ $fail -eq 0 ]
@@ -0,0 +1,73 @@
+#!/bin/bash
+set -e
+
+pass=0
+fail=0
+
+check() {
+    name="$1"
+    cmd="$2"
+    expected="$3"
+
+    actual=$(eval "$cmd" 2>&1 | grep -E "^-?[0-9]+$") || { echo "FAIL $name (error)"; fail=$((fail+1)); return; }
+    if [ "$actual" = "$expected" ]; then
+        echo "PASS $name"
+        pass=$((pass+1))
+    else
+        echo "FAIL $name"
+        printf "  expected: %s\n" "$expected"
+        printf "  actual: %s\n" "$actual"
+        fail=$((fail+1))
+    fi
+}
+
+E1_JIT="$1"
+E2_JIT="$2"
+EXAMPLES="$3"
+
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+
+# The examples through the in-process ORC JIT (e1_jit.hpp), with and without
+# the AST optimizer
+BIG=$(printf '1234567890%.0s' $(seq 1 200))
+for opt in "" " -O0"; do
+    check "factorial (jit$opt)" "$E1_JIT --jit$opt $EXAMPLES/factorial.e1 1 30" "265252859812191058636308480000000"
+    check "collatz (jit$opt)" "$E1_JIT --jit$opt $EXAMPLES/collatz.e1 5" "$(printf '5\n16\n8\n4\n2\n1')"
+    check "gcd (jit$opt)" "$E1_JIT --jit$opt $EXAMPLES/gcd.e1 48 18" "6"
+    check "gcd bigint args (jit$opt)" "$E1_JIT --jit$opt $EXAMPLES/gcd.e1 $BIG $BIG" "$BIG"
+    check "factorial e2 (jit$opt)" "$E2_JIT --jit$opt $EXAMPLES/factorial.e2 1 30" "265252859812191058636308480000000"
+    check "collatz e2 (jit$opt)" "$E2_JIT --jit$opt $EXAMPLES/collatz.e2 5" "$(printf '5\n16\n8\n4\n2\n1')"
+    check "gcd e2 (jit$opt)" "$E2_JIT --jit$opt $EXAMPLES/gcd.e2 48 18" "6"
+done
+check "factorial (jit, default<O1>)" "$E1_JIT --jit --jit-passes='default<O1>' $EXAMPLES/factorial.e1 3 20" \
+    "$($E1_JIT $EXAMPLES/factorial.e1 3 20)"
+
+# --jit-stats reports on stderr and leaves the program output alone
+out=$($E1_JIT --jit --jit-stats $EXAMPLES/factorial.e1 1 5 2> "$TMP/stats")
+if [ "$out" = "120" ] && grep -qE '^jit: compile [0-9]+\.[0-9]{3} ms, run [0-9]+\.[0-9]{3} ms$' "$TMP/stats"; then
+    echo "PASS jit stats"
+    pass=$((pass+1))
+else
+    echo "FAIL jit stats: $(cat "$TMP/stats")"
+    fail=$((fail+1))
+fi
+
+# Object cache: the cold run stores the parsed program and the compiled
+# module, the warm run is answered from the module's entry
+export E1_CACHE_DIR="$TMP/cache"
+check "factorial (jit, cache miss)" "$E1_JIT --jit $EXAMPLES/factorial.e1 1 30" "265252859812191058636308480000000"
+check "factorial (jit, cache hit)" "$E1_JIT --jit $EXAMPLES/factorial.e1 1 30" "265252859812191058636308480000000"
+stats=$($E1_JIT --cache-stats)
+if [ "$stats" = "$E1_CACHE_DIR: 1 hits, 2 misses, 2 entries, $(cat "$E1_CACHE_DIR"/*.e1c | wc -c) bytes (limit 268435456)" ]; then
+    echo "PASS jit cache"
+    pass=$((pass+1))
+else
+    echo "FAIL jit cache: $stats"
+    fail=$((fail+1))
+fi
+unset E1_CACHE_DIR
+
+echo ""
+echo "Results: $pass passed, $fail failed"
+[ $fail -eq 0 ]
@@ -0,0 +1,135 @@
+// Embeds //src:libe1 through its C API (libe1.h) and runs the examples
+// Usage: libe1_test <examples dir>
+#include "libe1.h"
+#include <cstdio>
+#include <fstream>
+#include <print>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+static int pass = 0, fail = 0;
+
+static void check(const std::string& name, bool ok, const std::string& detail = "") {
+    if (ok) {
+        std::println("PASS {}", name);
+        pass++;
+    } else {
+        std::println("FAIL {}{}", name, detail.empty() ? "" : ": " + detail);
+        fail++;
+    }
+}
+
+static std::string read(const std::string& path) {
+    std::ifstream in(path);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+static void append(void* user, const char* data, size_t len) { static_cast<std::string*>(user)->append(data, len); }
+
+// Output of one run of prog, or "status N" when it does not end with E1_OK
+static std::string run(e1_context* ctx, const e1_program* prog, std::vector<const char*> args) {
+    args.push_back(nullptr);
+    std::string out;
+    int st = e1_run_in(ctx, prog, args.data(), append, &out);
+    return st == E1_OK ? out : "status " + std::to_string(st);
+}
+
+int main(int argc, char** argv) {
+    std::string dir = argc > 1 ? argv[1] : "examples";
+    e1_context* ctx = e1_context_new();
+    e1_error err;
+
+    struct Case { const char* file; std::vector<const char*> args; const char* expected; };
+    const Case cases[] = {
+        {"example.e0", {}, "7\n1\n8\n"},
+        {"factorial.e1", {"1", "5"}, "120\n"},
+        {"collatz.e1", {"5"}, "5\n16\n8\n4\n2\n1\n"},
+        {"gcd.e1", {"48", "18"}, "6\n"},
+    };
+    const std::pair<e1_engine, const char*> engines[] = {
+        {E1_ENGINE_VM, "vm"}, {E1_ENGINE_CLOSURE, "closure"}, {E1_ENGINE_AST, "ast"},
+        {E1_ENGINE_BASELINE_JIT, "baseline-jit"}};
+    for (auto& c : cases) {
+        std::string src = read(dir + "/" + c.file);
+        for (auto [engine, name] : engines) {
+            e1_options opt;
+            e1_default_options(&opt);
+            opt.engine = engine;
+            e1_program* prog = e1_compile_with(src.data(), src.size(), &opt, &err);
+            std::string test = std::string(c.file) + " (" + name + ")";
+            if (!prog) { check(test, false, err.message); continue; }
+            std::string out = run(ctx, prog, c.args);
+            check(test, out == c.expected, out);
+            e1_program_free(prog);
+        }
+    }
+
+    // Parse errors carry line and column
+    std::string bad = "x := 1\nprint (x +\n  y @ 2)\n";
+    check("parse error", !e1_compile(bad.data(), bad.size(), &err) &&
+                             std::string(err.message) == "3:5: Unknown char: @", err.message);
+
+    std::string src = read(dir + "/factorial.e1");
+    e1_program* prog = e1_compile(src.data(), src.size(), &err);
+    check("invalid argument", run(ctx, prog, {"1", "5x"}) == "status 2");
+
+    // A context reused over many runs, with values of changing size, gives
+    // what a fresh one does
+    bool same = true;
+    for (int i = 0; i < 200 && same; ++i) {
+        std::string n = std::to_string(i * 7 % 40);
+        e1_context* fresh = e1_context_new();
+        same = run(ctx, prog, {"1", n.c_str()}) == run(fresh, prog, {"1", n.c_str()});
+        e1_context_free(fresh);
+    }
+    std::string f30 = run(ctx, prog, {"1", "30"});
+    check("context reuse", same && run(ctx, prog, {"1", "5"}) == "120\n" && f30 == "265252859812191058636308480000000\n", f30);
+
+    // A time limit stops a run that never ends
+    std::string forever = "print 1\nloop { x := x + 1 }\n";
+    e1_program* loop = e1_compile(forever.data(), forever.size(), &err);
+    e1_context_set_timeout(ctx, 50);
+    check("timeout", run(ctx, loop, {}) == "status 4" && run(ctx, prog, {"1", "5"}) == "120\n");
+    e1_context_set_timeout(ctx, 0);
+    e1_program_free(loop);
+
+    // One program, a context per thread (e1_run's own)
+    std::vector<std::string> outs(4);
+    {
+        std::vector<std::jthread> threads;
+        for (auto& o : outs)
+            threads.emplace_back([&o, prog] {
+                for (int i = 0; i < 50; ++i) {
+                    o.clear();
+                    const char* args[] = {"1", "30", nullptr};
+                    if (e1_run(prog, args, append, &o) != E1_OK) return;
+                }
+            });
+    }
+    bool all = true;
+    for (auto& o : outs) all = all && o == f30;
+    check("threads", all);
+
+    // Loops that only count down and add to accumulators, run on threads,
+    // give the sequential result in every engine
+    std::string seq = run(ctx, prog, {"37", "25"});
+    for (auto [engine, name] : engines) {
+        e1_options opt;
+        e1_default_options(&opt);
+        opt.engine = engine;
+        opt.threads = 4;
+        e1_program* par = e1_compile_with(src.data(), src.size(), &opt, &err);
+        std::string out = run(ctx, par, {"37", "25"});
+        check(std::string("parallel (") + name + ")", out == seq && run(ctx, par, {"1", "5"}) == "120\n", out);
+        e1_program_free(par);
+    }
+
+    e1_program_free(prog);
+    e1_context_free(ctx);
+    std::println("\nResults: {} passed, {} failed", pass, fail);
+    return fail != 0;
+}